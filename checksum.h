@@ -0,0 +1,27 @@
+/*
+ * Author: Matthieu Carteron <rubisetcie@gmail.com>
+ * date:   2024-08-24
+ *
+ * Provides the checksums of the data (CRC-32C and XXH64).
+ */
+
+#ifndef CHECKSUM_H_INCLUDED
+#define CHECKSUM_H_INCLUDED
+
+#include <stdlib.h>
+#include <stdint.h>
+
+typedef struct Checksum
+{
+    uint32_t crc;             /* Running CRC */
+    uint64_t accumulator[4];  /* Lanes of the hash */
+    unsigned char stripe[32]; /* Pending bytes of the hash stripe */
+    size_t pending;           /* Number of pending bytes */
+    uint64_t total;           /* Total number of bytes hashed */
+} Checksum;
+
+void checksumInit(Checksum *checksum);
+void checksumUpdate(Checksum *checksum, const unsigned char *data, size_t length);
+void checksumFinal(const Checksum *checksum, uint32_t *crc, uint64_t *hash);
+
+#endif
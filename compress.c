@@ -0,0 +1,296 @@
+/*
+ * Author: Matthieu Carteron <rubisetcie@gmail.com>
+ * date:   2024-08-24
+ *
+ * Provides the compression of the data and its decompression runtime.
+ *
+ * The compressed data is a sequence of tokens:
+ *  - 0xxxxxxx: a run of x + 1 literal bytes follows;
+ *  - 1xxxxxxx: a copy of x + 3 bytes from the decoded data, at the distance
+ *              given by the two following bytes (little endian, minus one).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "compress.h"
+
+/* Parameters of the format (shared with the runtime) */
+#define WINDOW_SIZE  4096
+#define MIN_MATCH    3
+#define MAX_MATCH    (0x7f + MIN_MATCH)
+#define MAX_LITERALS 0x80
+
+/* Parameters of the match finder */
+#define HASH_BITS    14
+#define HASH_SIZE    (1 << HASH_BITS)
+#define MAX_CHAIN    32
+
+/* Source code of the decompression runtime */
+static const char *const runtime[] =
+{
+    "#include <stddef.h>",
+    "#include <stdlib.h>",
+    "#include <string.h>",
+    "",
+    "#ifndef BINCLUDE_RUNTIME_DEFINED",
+    "#define BINCLUDE_RUNTIME_DEFINED",
+    "",
+    "#ifndef BINCLUDE_INLINE",
+    "#if defined(__cplusplus) || (defined(__STDC_VERSION__) && __STDC_VERSION__ >= 199901L)",
+    "#define BINCLUDE_INLINE static inline",
+    "#else",
+    "#define BINCLUDE_INLINE static",
+    "#endif",
+    "#endif",
+    "",
+    "#if defined(_MSC_VER)",
+    "#include <intrin.h>",
+    "#define BINCLUDE_LOAD(p) ((unsigned char *)_InterlockedCompareExchangePointer((void *volatile *)(p), NULL, NULL))",
+    "#define BINCLUDE_CAS(p, n) (_InterlockedCompareExchangePointer((void *volatile *)(p), (n), NULL) == NULL)",
+    "#define BINCLUDE_SWAP(p) ((unsigned char *)_InterlockedExchangePointer((void *volatile *)(p), NULL))",
+    "#else",
+    "#define BINCLUDE_LOAD(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)",
+    "#define BINCLUDE_CAS(p, n) __sync_bool_compare_and_swap((p), (unsigned char *)NULL, (n))",
+    "#define BINCLUDE_SWAP(p) __atomic_exchange_n((p), (unsigned char *)NULL, __ATOMIC_ACQ_REL)",
+    "#endif",
+    "",
+    "#define BINCLUDE_WINDOW 4096",
+    "",
+    "/* State of a streaming decompression */",
+    "typedef struct binclude_stream",
+    "{",
+    "    const unsigned char *source; /* Compressed data */",
+    "    size_t position;             /* Position in the compressed data */",
+    "    size_t length;               /* Length of the compressed data */",
+    "    size_t written;              /* Number of bytes decoded so far */",
+    "    unsigned int remaining;      /* Bytes left in the current token */",
+    "    unsigned int distance;       /* Distance of the current copy (0 for literals) */",
+    "    int stored;                  /* The data is stored without compression */",
+    "    unsigned char window[BINCLUDE_WINDOW];",
+    "} binclude_stream;",
+    "",
+    "/* Start the decompression of some data */",
+    "BINCLUDE_INLINE void binclude_stream_init(binclude_stream *stream, const unsigned char *source, size_t length)",
+    "{",
+    "    stream->source = source;",
+    "    stream->position = 0;",
+    "    stream->length = length;",
+    "    stream->written = 0;",
+    "    stream->remaining = 0;",
+    "    stream->distance = 0;",
+    "    stream->stored = 0;",
+    "}",
+    "",
+    "/* Start the reading of some data stored without compression */",
+    "BINCLUDE_INLINE void binclude_stream_init_stored(binclude_stream *stream, const unsigned char *source, size_t length)",
+    "{",
+    "    binclude_stream_init(stream, source, length);",
+    "    stream->stored = 1;",
+    "}",
+    "",
+    "/* Decode up to size bytes in the buffer, return the number of bytes decoded (0 at the end) */",
+    "BINCLUDE_INLINE size_t binclude_stream_read(binclude_stream *stream, void *buffer, size_t size)",
+    "{",
+    "    unsigned char *output = (unsigned char *)buffer;",
+    "    const unsigned char *source = stream->source;",
+    "    size_t produced = 0;",
+    "    unsigned char byte;",
+    "",
+    "    /* Copy the stored data as is */",
+    "    if (stream->stored)",
+    "    {",
+    "        produced = stream->length - stream->position < size ? stream->length - stream->position : size;",
+    "        memcpy(output, source + stream->position, produced);",
+    "        stream->position += produced;",
+    "        stream->written += produced;",
+    "        return produced;",
+    "    }",
+    "",
+    "    while (produced < size)",
+    "    {",
+    "        /* Read the next token */",
+    "        if (stream->remaining == 0)",
+    "        {",
+    "            if (stream->position >= stream->length)",
+    "                break;",
+    "",
+    "            byte = source[stream->position++];",
+    "            if (byte & 0x80)",
+    "            {",
+    "                stream->remaining = (byte & 0x7f) + 3;",
+    "                stream->distance = (source[stream->position] | (source[stream->position + 1] << 8)) + 1;",
+    "                stream->position += 2;",
+    "            }",
+    "            else",
+    "            {",
+    "                stream->remaining = byte + 1;",
+    "                stream->distance = 0;",
+    "            }",
+    "        }",
+    "",
+    "        /* Decode the byte and remember it for the next copies */",
+    "        if (stream->distance)",
+    "            byte = stream->window[(stream->written - stream->distance) & (BINCLUDE_WINDOW - 1)];",
+    "        else",
+    "            byte = source[stream->position++];",
+    "",
+    "        stream->window[stream->written & (BINCLUDE_WINDOW - 1)] = byte;",
+    "        output[produced++] = byte;",
+    "        stream->written++;",
+    "        stream->remaining--;",
+    "    }",
+    "    return produced;",
+    "}",
+    "",
+    "/* Get the decompressed data, decoding it in the cache on first use (thread-safe) */",
+    "BINCLUDE_INLINE const unsigned char *binclude_acquire(unsigned char **cache, const unsigned char *source, size_t length, size_t size)",
+    "{",
+    "    binclude_stream stream;",
+    "    unsigned char *data = BINCLUDE_LOAD(cache);",
+    "",
+    "    if (data != NULL)",
+    "        return data;",
+    "",
+    "    /* Decode in a new buffer, then publish it unless another thread was faster */",
+    "    if ((data = (unsigned char *)malloc(size > 0 ? size : 1)) == NULL)",
+    "        return NULL;",
+    "",
+    "    binclude_stream_init(&stream, source, length);",
+    "    binclude_stream_read(&stream, data, size);",
+    "",
+    "    if (!BINCLUDE_CAS(cache, data))",
+    "    {",
+    "        free(data);",
+    "        data = BINCLUDE_LOAD(cache);",
+    "    }",
+    "    return data;",
+    "}",
+    "",
+    "/* Free the cached data (it must not be used anymore) */",
+    "BINCLUDE_INLINE void binclude_release(unsigned char **cache)",
+    "{",
+    "    free(BINCLUDE_SWAP(cache));",
+    "}",
+    "",
+    "#endif",
+    "",
+    NULL
+};
+
+/* Hash the next bytes to find the previous occurrences */
+static size_t hash(const unsigned char *data)
+{
+    return ((data[0] << 16 | data[1] << 8 | data[2]) * 2654435761UL >> (32 - HASH_BITS)) & (HASH_SIZE - 1);
+}
+
+/* Write a run of literal bytes */
+static size_t writeLiterals(const unsigned char *input, size_t length, unsigned char *output)
+{
+    size_t written = 0, run;
+    while (length > 0)
+    {
+        run = length > MAX_LITERALS ? MAX_LITERALS : length;
+        output[written++] = run - 1;
+
+        memcpy(output + written, input, run);
+        written += run;
+        input += run;
+        length -= run;
+    }
+    return written;
+}
+
+/* Compress the data (the output must hold COMPRESS_BOUND(length) bytes) */
+bool compress(const unsigned char *input, const size_t length, unsigned char *output, size_t *compressedLength)
+{
+    long *head, *chain, candidate;
+    size_t position = 0, literals = 0, written = 0, best, distance, limit, match, i, h;
+    int depth;
+
+    /* Allocate the match finder tables */
+    if ((head = malloc(HASH_SIZE * sizeof(long))) == NULL)
+        return false;
+    if ((chain = malloc(WINDOW_SIZE * sizeof(long))) == NULL)
+    {
+        free(head);
+        return false;
+    }
+
+    for (i = 0; i < HASH_SIZE; i++)
+        head[i] = -1;
+
+    while (position < length)
+    {
+        best = 0;
+        distance = 0;
+
+        if (position + MIN_MATCH <= length)
+        {
+            limit = length - position < MAX_MATCH ? length - position : MAX_MATCH;
+
+            /* Look for the longest match among the previous occurrences */
+            h = hash(input + position);
+            for (candidate = head[h], depth = MAX_CHAIN; candidate >= 0 && position - candidate <= WINDOW_SIZE && depth > 0; candidate = chain[candidate & (WINDOW_SIZE - 1)], depth--)
+            {
+                for (match = 0; match < limit && input[candidate + match] == input[position + match]; match++);
+
+                if (match > best)
+                {
+                    best = match;
+                    distance = position - candidate;
+                    if (best == limit)
+                        break;
+                }
+            }
+        }
+
+        /* Keep the byte as a literal if no match is long enough */
+        if (best < MIN_MATCH)
+            best = 1;
+        else
+        {
+            written += writeLiterals(input + position - literals, literals, output + written);
+            literals = 0;
+
+            output[written++] = 0x80 | (best - MIN_MATCH);
+            output[written++] = (distance - 1) & 0xff;
+            output[written++] = (distance - 1) >> 8;
+        }
+
+        /* Remember the occurrences of the bytes consumed */
+        for (i = 0; i < best; i++, position++)
+        {
+            if (best == 1)
+                literals++;
+
+            if (position + MIN_MATCH <= length)
+            {
+                h = hash(input + position);
+                chain[position & (WINDOW_SIZE - 1)] = head[h];
+                head[h] = position;
+            }
+        }
+    }
+
+    written += writeLiterals(input + position - literals, literals, output + written);
+
+    free(head);
+    free(chain);
+
+    *compressedLength = written;
+    return true;
+}
+
+/* Write the source code of the decompression runtime */
+bool writeRuntime(FILE *file)
+{
+    size_t i;
+    for (i = 0; runtime[i] != NULL; i++)
+    {
+        fputs(runtime[i], file);
+        fputc('\n', file);
+    }
+    return !ferror(file);
+}
@@ -0,0 +1,21 @@
+/*
+ * Author: Matthieu Carteron <rubisetcie@gmail.com>
+ * date:   2024-08-24
+ *
+ * Provides the compression of the data and its decompression runtime.
+ */
+
+#ifndef COMPRESS_H_INCLUDED
+#define COMPRESS_H_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+/* Maximum size of the compressed data (at worst, single literals alternate with the shortest copies) */
+#define COMPRESS_BOUND(length) ((length) + (length) / 4 + 2)
+
+bool compress(const unsigned char *input, const size_t length, unsigned char *output, size_t *compressedLength);
+bool writeRuntime(FILE *file);
+
+#endif
@@ -25,6 +25,17 @@ typedef struct Config
     bool text;           /* Put data line by line as a text */
     bool singleLine;     /* Write the data as a single line */
     bool warning;        /* Write the auto-generated warning */
+    bool cxxConstexpr;   /* Use C++17 inline constexpr definitions */
+    bool trimZeros;      /* Leave the trailing zeros out of the initializer */
+    bool compress;       /* Compress the data and decompress it on first use */
+    bool checksum;       /* Write the checksums of the data */
+    bool dense;          /* Write the bytes with as few characters as possible */
+    int jobs;            /* Maximum number of threads (0 for all processors) */
+    bool minify;         /* Minify the files depending on their type */
+    bool normalizeLines; /* Replace the CRLF new lines with LF */
+    bool nullTerminate;  /* Append a null byte to the data */
+    bool embed;          /* Let the compiler load the data with #embed */
+    bool embedFallback;  /* Write the byte list for the compilers without #embed */
 } Config;
 
 #endif
@@ -0,0 +1,122 @@
+/*
+ * Author: Matthieu Carteron <rubisetcie@gmail.com>
+ * date:   2024-08-24
+ *
+ * Provides the paths of the files embedded by the compiler.
+ *
+ * The #embed directive looks for the files relatively to the directory of the
+ * source including them, so the paths are written relatively to the file
+ * holding the definitions.
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "embed.h"
+
+/* Absolute path of the directory holding the definitions (without trailing separator) */
+static char embedDirectory[FILENAME_MAX];
+
+/* Resolve the absolute path of an existing file (with slashes as separators) */
+static bool resolvePath(const char *filename, char *path)
+{
+#ifdef _WIN32
+    size_t i;
+    if (_fullpath(path, filename, FILENAME_MAX) == NULL)
+        return false;
+
+    for (i = 0; path[i] != '\0'; i++)
+    {
+        if (path[i] == '\\')
+            path[i] = '/';
+    }
+    return true;
+#else
+    char *resolved;
+    if ((resolved = realpath(filename, NULL)) == NULL)
+        return false;
+
+    if (strlen(resolved) >= FILENAME_MAX)
+    {
+        free(resolved);
+        return false;
+    }
+
+    strcpy(path, resolved);
+    free(resolved);
+    return true;
+#endif
+}
+
+/* Compare two characters of a path (the Windows paths are case insensitive) */
+static bool sameCharacter(const char a, const char b)
+{
+#ifdef _WIN32
+    return tolower((unsigned char)a) == tolower((unsigned char)b);
+#else
+    return a == b;
+#endif
+}
+
+/* Set the directory of the file holding the definitions (it must exist) */
+bool setupEmbedDirectory(const char *file)
+{
+    char *separator;
+
+    if (!resolvePath(file, embedDirectory))
+        return false;
+
+    /* Remove the file name (the root directory becomes empty) */
+    if ((separator = strrchr(embedDirectory, '/')) != NULL)
+        *separator = '\0';
+
+    return true;
+}
+
+/* Make up the path of an input file relative to the directory of the definitions */
+bool setupEmbedPath(const char *filename, char *path)
+{
+    char full[FILENAME_MAX];
+    size_t i, parents = 0;
+    long common = -1;
+
+    if (!resolvePath(filename, full))
+        return false;
+
+    /* Find the last separator ending the common directories */
+    for (i = 0; embedDirectory[i] != '\0' && sameCharacter(embedDirectory[i], full[i]); i++)
+    {
+        if (embedDirectory[i] == '/')
+            common = i;
+    }
+    if (embedDirectory[i] == '\0' && full[i] == '/')
+        common = i;
+
+    /* Nothing in common (on different drives): keep the absolute path */
+    if (common < 0)
+    {
+        strcpy(path, full);
+        return true;
+    }
+
+    /* Go up from the directories which aren't in common */
+    for (i = common; embedDirectory[i] != '\0'; i++)
+    {
+        if (embedDirectory[i] == '/')
+            parents++;
+    }
+
+    if (parents * 3 + strlen(full + common + 1) >= FILENAME_MAX)
+        return false;
+
+    path[0] = '\0';
+    for (i = 0; i < parents; i++)
+        strcat(path, "../");
+
+    strcat(path, full + common + 1);
+    return true;
+}
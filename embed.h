@@ -0,0 +1,16 @@
+/*
+ * Author: Matthieu Carteron <rubisetcie@gmail.com>
+ * date:   2024-08-24
+ *
+ * Provides the paths of the files embedded by the compiler.
+ */
+
+#ifndef EMBED_H_INCLUDED
+#define EMBED_H_INCLUDED
+
+#include <stdbool.h>
+
+bool setupEmbedDirectory(const char *file);
+bool setupEmbedPath(const char *filename, char *path);
+
+#endif
@@ -0,0 +1,194 @@
+/*
+ * Author: Matthieu Carteron <rubisetcie@gmail.com>
+ * date:   2024-08-24
+ *
+ * Provides a client of the GNU make jobserver.
+ *
+ * The jobserver is advertised in MAKEFLAGS by "--jobserver-auth=fifo:PATH"
+ * (named pipe) or "--jobserver-auth=R,W" ("--jobserver-fds" before make 4.2)
+ * with the file descriptors of a pipe. Every byte read from it is a token
+ * allowing one more job, and must be written back once the job is done.
+ *
+ * The descriptors are only inherited by the recursive rules, and may be
+ * reused by any file opened meanwhile: the jobserver has to be opened before
+ * the outputs, and the descriptors must be pipes.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+#include "jobserver.h"
+
+#ifndef _WIN32
+
+/* Descriptors of the jobserver */
+static int readFd = -1, writeFd = -1;
+static bool ownFds = false;
+
+/* Find the value of the last jobserver option in MAKEFLAGS */
+static const char *findAuth(const char *flags, size_t *length)
+{
+    static const char *const options[] = { "--jobserver-auth=", "--jobserver-fds=" };
+    const char *found = NULL, *position;
+    size_t i;
+
+    for (i = 0; i < sizeof(options) / sizeof(options[0]); i++)
+    {
+        for (position = strstr(flags, options[i]); position != NULL; position = strstr(position + 1, options[i]))
+        {
+            if (found == NULL || position > found)
+                found = position + strlen(options[i]);
+        }
+    }
+
+    if (found != NULL)
+        *length = strcspn(found, " ");
+    return found;
+}
+
+/* Check if an inherited descriptor is the end of a pipe opened in the given mode */
+static bool isPipe(const int fd, const int mode)
+{
+    struct stat status;
+    int flags;
+
+    if (fd < 0 || fstat(fd, &status) != 0 || !S_ISFIFO(status.st_mode))
+        return false;
+
+    return (flags = fcntl(fd, F_GETFL)) >= 0 && (flags & O_ACCMODE) == mode;
+}
+
+/* Connect to the jobserver of the calling make (if any, before opening any file) */
+JobserverState jobserverOpen(void)
+{
+    const char *flags = getenv("MAKEFLAGS"), *auth;
+    char value[FILENAME_MAX];
+    size_t length;
+    int r, w;
+
+    if (flags == NULL || (auth = findAuth(flags, &length)) == NULL)
+        return J_ABSENT;
+
+    if (length >= sizeof(value))
+        return J_UNUSABLE;
+
+    memcpy(value, auth, length);
+    value[length] = '\0';
+
+    if (strncmp(value, "fifo:", 5) == 0)
+    {
+        /* Named pipe: open it twice, one end being non-blocking */
+        if ((readFd = open(value + 5, O_RDONLY | O_NONBLOCK)) < 0)
+            return J_UNUSABLE;
+        if ((writeFd = open(value + 5, O_WRONLY)) < 0)
+        {
+            jobserverClose();
+            return J_UNUSABLE;
+        }
+        ownFds = true;
+    }
+    else if (sscanf(value, "%d,%d", &r, &w) == 2)
+    {
+        /* Anonymous pipe: the descriptors are only inherited if the rule is recursive */
+        if (!isPipe(r, O_RDONLY) || !isPipe(w, O_WRONLY))
+            return J_UNUSABLE;
+        readFd = r;
+        writeFd = w;
+    }
+    else
+        return J_UNUSABLE;
+
+    return J_CONNECTED;
+}
+
+/* Try to take a token without waiting */
+bool jobserverAcquire(char *token)
+{
+    struct pollfd request;
+    ssize_t result;
+    int flags;
+
+    if (readFd < 0)
+        return false;
+
+    /* Only read once a token is there */
+    request.fd = readFd;
+    request.events = POLLIN;
+    request.revents = 0;
+    if (poll(&request, 1, 0) != 1 || !(request.revents & POLLIN))
+        return false;
+
+    /* Another job may take the token meanwhile: the read must not wait (make itself already reads without blocking) */
+    if ((flags = fcntl(readFd, F_GETFL)) < 0)
+        return false;
+    if (!(flags & O_NONBLOCK) && fcntl(readFd, F_SETFL, flags | O_NONBLOCK) < 0)
+        return false;
+
+    result = read(readFd, token, 1);
+
+    if (!(flags & O_NONBLOCK))
+        fcntl(readFd, F_SETFL, flags);
+
+    return result == 1;
+}
+
+/* Give a token back */
+void jobserverRelease(char token)
+{
+    if (writeFd < 0)
+        return;
+
+    while (write(writeFd, &token, 1) < 0 && errno == EINTR);
+}
+
+/* Disconnect from the jobserver */
+void jobserverClose(void)
+{
+    /* The inherited descriptors belong to make */
+    if (ownFds)
+    {
+        if (readFd >= 0)
+            close(readFd);
+        if (writeFd >= 0)
+            close(writeFd);
+    }
+
+    readFd = -1;
+    writeFd = -1;
+    ownFds = false;
+}
+
+#else
+
+/* The jobserver of make on Windows (semaphores) is not supported */
+JobserverState jobserverOpen(void)
+{
+    return getenv("MAKEFLAGS") && strstr(getenv("MAKEFLAGS"), "--jobserver-auth=") ? J_UNUSABLE : J_ABSENT;
+}
+
+bool jobserverAcquire(char *token)
+{
+    (void)token;
+    return false;
+}
+
+void jobserverRelease(char token)
+{
+    (void)token;
+}
+
+void jobserverClose(void)
+{
+}
+
+#endif
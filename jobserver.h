@@ -0,0 +1,25 @@
+/*
+ * Author: Matthieu Carteron <rubisetcie@gmail.com>
+ * date:   2024-08-24
+ *
+ * Provides a client of the GNU make jobserver.
+ */
+
+#ifndef JOBSERVER_H_INCLUDED
+#define JOBSERVER_H_INCLUDED
+
+#include <stdbool.h>
+
+typedef enum JobserverState
+{
+    J_ABSENT,    /* No jobserver is advertised */
+    J_CONNECTED, /* The jobserver can be used */
+    J_UNUSABLE   /* A jobserver is advertised but can't be reached */
+} JobserverState;
+
+JobserverState jobserverOpen(void);
+bool jobserverAcquire(char *token);
+void jobserverRelease(char token);
+void jobserverClose(void);
+
+#endif
@@ -17,6 +17,10 @@
 
 #include "config.h"
 #include "packer.h"
+#include "compress.h"
+#include "parallel.h"
+#include "jobserver.h"
+#include "embed.h"
 #include "format.h"
 
 /* Version number */
@@ -27,8 +31,8 @@
 Config config;              /* Configuration */
 const char *output = NULL;  /* Output file name */
 const char *header = NULL;  /* Header file name */
-char *symbolMacro = NULL;   /* Symbol name (macro) */
-char *symbol = NULL;        /* Symbol name (general use) */
+const char *pack = NULL;    /* Pack file name */
+FILE *packFile = NULL;      /* Pack file */
 
 /* Check if a file name represents a C / C++ source file or a header (based on the extension) */
 static void checkFiletype(const char *filename, bool *isHeader, bool *isCXX)
@@ -95,45 +99,97 @@ static void setHeader(const char *name)
     header = name;
 }
 
+/* Open a pack file */
+static void setPack(const char *name)
+{
+    /* Be sure that a file name is given */
+    if (!name || name[0] == '-')
+    {
+        fputs("Missing file name after pack parameter!\n", stderr);
+        return;
+    }
+    pack = name;
+}
+
+/* Set the number of jobs */
+static void setJobs(const char *count)
+{
+    /* Be sure that a number is given */
+    if (!count || count[0] < '0' || count[0] > '9')
+    {
+        fputs("Missing number after jobs parameter!\n", stderr);
+        return;
+    }
+    config.jobs = atoi(count);
+}
+
 /* Print the command-line usage */
 static void usage(const char *program)
 {
 #ifdef _WIN32
     printf("Usage: %s [<options...>] <file1> <file2> <...>\n\n\
 Options:\n\
-  -h, --help           : Display command-line usage.\n\
-  -o, --output <file>  : Specify the output file (can be source or header).\n\
-  -d, --header <file>  : Specify a header file (won't be created otherwise).\n\
-  -w, --no-warning     : Suppress the auto-generated warning comment in output.\n\
-  -a, --no-allman      : Disable the Allman style of indentation and use the K&R.\n\
-  -f, --decimal        : Format byte data as decimal rather than hexadecimal.\n\
-  -t, --text           : Write data as a text form rather than byte per byte.\n\
-  -m, --macro          : Create the size definition as a macro instead of a const.\n\
-  -c, --camel-case     : Use the camel case for names instead of the snake case.\n\
-  -s, --single-line    : Put all the data on a single line.\n\
-  -v, --version        : Print program version.\n\n\
+  -h, --help            : Display command-line usage.\n\
+  -o, --output <file>   : Specify the output file (can be source or header).\n\
+  -d, --header <file>   : Specify a header file (won't be created otherwise).\n\
+  -w, --no-warning      : Suppress the auto-generated warning comment in output.\n\
+  -a, --no-allman       : Disable the Allman style of indentation and use the K&R.\n\
+  -f, --decimal         : Format byte data as decimal rather than hexadecimal.\n\
+  -t, --text            : Write data as a text form rather than byte per byte.\n\
+  -m, --macro           : Create the size definition as a macro instead of a const.\n\
+  -c, --camel-case      : Use the camel case for names instead of the snake case.\n\
+  -s, --single-line     : Put all the data on a single line.\n\
+  -n, --dense           : Write byte data as short as possible.\n\
+  -x, --constexpr       : Define the data as C++17 inline constexpr.\n\
+  -z, --trim-zeros      : Leave the trailing zero bytes out of the initializer.\n\
+  -l, --compress        : Compress the data and decompress it on first use.\n\
+  -k, --checksum        : Write the CRC-32C and the XXH64 hash of the data.\n\
+  -p, --pack <file>     : Write the data in a pack file, mapped at runtime.\n\
+  -j, --jobs <count>    : Process files on several threads (0 for all processors).\n\
+  -i, --minify          : Minify the JSON and shader files (by extension).\n\
+  -r, --normalize-lines : Replace the CRLF new lines with LF.\n\
+  -0, --null-terminate  : Append a null byte to the data.\n\
+  -e, --embed           : Let the compiler load the data with C23 #embed.\n\
+  -b, --embed-fallback  : Embed, with the byte list for the other compilers.\n\
+  -v, --version         : Print program version.\n\n\
 Examples:\n\
   %s -o foo.h bar.bin\n\
   %s -o foo.h file1 file2\n\
-  %s -o foo.c -d foo.h bar.bin\n\n", program, program, program, program);
+  %s -o foo.c -d foo.h bar.bin\n\
+  %s -x -o foo.hpp bar.bin\n\
+  %s -p foo.pak -o foo.c -d foo.h file1 file2\n\n", program, program, program, program, program, program);
 #else
     printf("Usage: %1$s [<options...>] <file1> <file2> <...>\n\n\
 Options:\n\
-  -h, --help           : Display command-line usage.\n\
-  -o, --output <file>  : Specify the output file (can be source or header).\n\
-  -d, --header <file>  : Specify a header file (won't be created otherwise).\n\
-  -w, --no-warning     : Suppress the auto-generated warning comment in output.\n\
-  -a, --no-allman      : Disable the Allman style of indentation and use the K&R.\n\
-  -f, --decimal        : Format byte data as decimal rather than hexadecimal.\n\
-  -t, --text           : Write data as a text form rather than byte per byte.\n\
-  -m, --macro          : Create the size definition as a macro instead of a const.\n\
-  -c, --camel-case     : Use the camel case for names instead of the snake case.\n\
-  -s, --single-line    : Put all the data on a single line.\n\
-  -v, --version        : Print program version.\n\n\
+  -h, --help            : Display command-line usage.\n\
+  -o, --output <file>   : Specify the output file (can be source or header).\n\
+  -d, --header <file>   : Specify a header file (won't be created otherwise).\n\
+  -w, --no-warning      : Suppress the auto-generated warning comment in output.\n\
+  -a, --no-allman       : Disable the Allman style of indentation and use the K&R.\n\
+  -f, --decimal         : Format byte data as decimal rather than hexadecimal.\n\
+  -t, --text            : Write data as a text form rather than byte per byte.\n\
+  -m, --macro           : Create the size definition as a macro instead of a const.\n\
+  -c, --camel-case      : Use the camel case for names instead of the snake case.\n\
+  -s, --single-line     : Put all the data on a single line.\n\
+  -n, --dense           : Write byte data as short as possible.\n\
+  -x, --constexpr       : Define the data as C++17 inline constexpr.\n\
+  -z, --trim-zeros      : Leave the trailing zero bytes out of the initializer.\n\
+  -l, --compress        : Compress the data and decompress it on first use.\n\
+  -k, --checksum        : Write the CRC-32C and the XXH64 hash of the data.\n\
+  -p, --pack <file>     : Write the data in a pack file, mapped at runtime.\n\
+  -j, --jobs <count>    : Process files on several threads (0 for all processors).\n\
+  -i, --minify          : Minify the JSON and shader files (by extension).\n\
+  -r, --normalize-lines : Replace the CRLF new lines with LF.\n\
+  -0, --null-terminate  : Append a null byte to the data.\n\
+  -e, --embed           : Let the compiler load the data with C23 #embed.\n\
+  -b, --embed-fallback  : Embed, with the byte list for the other compilers.\n\
+  -v, --version         : Print program version.\n\n\
 Examples:\n\
   %1$s -o foo.h bar.bin\n\
   %1$s -o foo.h file1 file2\n\
-  %1$s -o foo.c -d foo.h bar.bin\n\n", program);
+  %1$s -o foo.c -d foo.h bar.bin\n\
+  %1$s -x -o foo.hpp bar.bin\n\
+  %1$s -p foo.pak -o foo.c -d foo.h file1 file2\n\n", program);
 #endif
 }
 
@@ -146,10 +202,11 @@ static void version(const char *program)
 /* Entry point function */
 int main(int argc, char **argv)
 {
-    FILE *outputFile = NULL, *headerFile = NULL;
+    FILE *outputFile = NULL, *headerFile = NULL, *definitionOutput;
     const char *headerBasename = NULL;
     bool outputHeader, outputCXX, headerCXX;
     int i, files = -1, retval = 0, rv2;
+    JobserverState jobserver;
 
     /* Display help if no command line arguments are given */
     if (argc <= 1)
@@ -158,6 +215,9 @@ int main(int argc, char **argv)
         return 0;
     }
 
+    /* Connect to the jobserver before opening any file (the inherited descriptors may be closed and reused) */
+    jobserver = jobserverOpen();
+
     /* Initialize the configuration to default state */
     config.createMacro = false;
     config.camelCase = false;
@@ -165,6 +225,17 @@ int main(int argc, char **argv)
     config.text = false;
     config.allman = true;
     config.warning = true;
+    config.cxxConstexpr = false;
+    config.trimZeros = false;
+    config.compress = false;
+    config.checksum = false;
+    config.dense = false;
+    config.jobs = 1;
+    config.minify = false;
+    config.normalizeLines = false;
+    config.nullTerminate = false;
+    config.embed = false;
+    config.embedFallback = false;
     config.format = F_HEXADECIMAL;
 
     /* Parse command-line arguments */
@@ -191,6 +262,10 @@ int main(int argc, char **argv)
                         setOutput(argv[++i]);
                     else if (strcmp(argv[i], "--header") == 0)
                         setHeader(argv[++i]);
+                    else if (strcmp(argv[i], "--pack") == 0)
+                        setPack(argv[++i]);
+                    else if (strcmp(argv[i], "--jobs") == 0)
+                        setJobs(argv[++i]);
                     else if (strcmp(argv[i], "--no-allman") == 0)
                         config.allman = false;
                     else if (strcmp(argv[i], "--no-warning") == 0)
@@ -205,23 +280,55 @@ int main(int argc, char **argv)
                         config.camelCase = true;
                     else if (strcmp(argv[i], "--decimal") == 0)
                         config.format = F_DECIMAL;
+                    else if (strcmp(argv[i], "--constexpr") == 0)
+                        config.cxxConstexpr = true;
+                    else if (strcmp(argv[i], "--trim-zeros") == 0)
+                        config.trimZeros = true;
+                    else if (strcmp(argv[i], "--compress") == 0)
+                        config.compress = true;
+                    else if (strcmp(argv[i], "--checksum") == 0)
+                        config.checksum = true;
+                    else if (strcmp(argv[i], "--dense") == 0)
+                        config.dense = true;
+                    else if (strcmp(argv[i], "--minify") == 0)
+                        config.minify = true;
+                    else if (strcmp(argv[i], "--normalize-lines") == 0)
+                        config.normalizeLines = true;
+                    else if (strcmp(argv[i], "--null-terminate") == 0)
+                        config.nullTerminate = true;
+                    else if (strcmp(argv[i], "--embed") == 0)
+                        config.embed = true;
+                    else if (strcmp(argv[i], "--embed-fallback") == 0)
+                        config.embedFallback = true;
                     else
                     {
                         fprintf(stderr, "Unrecognized parameter: %s\n", argv[i]);
                         return 1;
                     }
                     break;
-                case 'h': usage(argv[0]);            return 0;
-                case 'v': version(argv[0]);          return 0;
-                case 'o': setOutput(argv[++i]);      break;
-                case 'd': setHeader(argv[++i]);      break;
-                case 'w': config.warning = false;    break;
-                case 'a': config.allman = false;     break;
-                case 't': config.text = true;        break;
-                case 's': config.singleLine = true;  break;
-                case 'c': config.camelCase = true;   break;
-                case 'm': config.createMacro = true; break;
-                case 'f': config.format = F_DECIMAL; break;
+                case 'h': usage(argv[0]);               return 0;
+                case 'v': version(argv[0]);             return 0;
+                case 'o': setOutput(argv[++i]);         break;
+                case 'd': setHeader(argv[++i]);         break;
+                case 'p': setPack(argv[++i]);           break;
+                case 'j': setJobs(argv[++i]);           break;
+                case 'w': config.warning = false;       break;
+                case 'a': config.allman = false;        break;
+                case 't': config.text = true;           break;
+                case 's': config.singleLine = true;     break;
+                case 'c': config.camelCase = true;      break;
+                case 'm': config.createMacro = true;    break;
+                case 'f': config.format = F_DECIMAL;    break;
+                case 'x': config.cxxConstexpr = true;   break;
+                case 'z': config.trimZeros = true;      break;
+                case 'l': config.compress = true;       break;
+                case 'k': config.checksum = true;       break;
+                case 'n': config.dense = true;          break;
+                case 'i': config.minify = true;         break;
+                case 'r': config.normalizeLines = true; break;
+                case '0': config.nullTerminate = true;  break;
+                case 'e': config.embed = true;          break;
+                case 'b': config.embedFallback = true;  break;
                 default:
                     fprintf(stderr, "Unrecognized parameter: %s\n", argv[i]);
                     return 1;
@@ -249,6 +356,31 @@ int main(int argc, char **argv)
         return 2;
     }
 
+    /* The compressed data is only written in numerical form, and decompressed at runtime */
+    if (config.compress && (config.text || config.cxxConstexpr))
+    {
+        fputs("The compression can't be used with the text form nor the constexpr definitions!\n", stderr);
+        return 2;
+    }
+
+    /* The packed data is only mapped at runtime */
+    if (pack && (config.compress || config.text || config.cxxConstexpr))
+    {
+        fputs("The pack can't be used with the compression, the text form nor the constexpr definitions!\n", stderr);
+        return 2;
+    }
+
+    /* The fallback comes along with the embedding */
+    if (config.embedFallback)
+        config.embed = true;
+
+    /* The embedded files are read as is by the compiler */
+    if (config.embed && (pack || config.compress || config.text || config.cxxConstexpr || config.minify || config.normalizeLines || config.nullTerminate))
+    {
+        fputs("The embedding can't be used with the pack, the compression, the text form, the constexpr definitions nor the transformations!\n", stderr);
+        return 2;
+    }
+
     /* Determine the output file type */
     checkFiletype(output, &outputHeader, &outputCXX);
 
@@ -267,6 +399,13 @@ int main(int argc, char **argv)
     if (header)
         checkFiletype(header, &outputHeader, &headerCXX);
 
+    /* The constexpr definitions can only be written in C++ */
+    if (config.cxxConstexpr && !(header ? headerCXX : outputCXX))
+    {
+        fputs("The constexpr definitions require a C++ output file!\n", stderr);
+        return 2;
+    }
+
 #ifdef _WIN32
     headerBasename = PathFindFileName(header);
 #else
@@ -345,41 +484,105 @@ int main(int argc, char **argv)
         }
     }
 
-    /* Allocate the buffers for the symbols */
-    if ((symbol = malloc(FILENAME_MAX)) == NULL)
+    /* Write the standard includes needed by the constexpr definitions */
+    if (config.cxxConstexpr)
     {
-        fputs("Failed to allocate memory for the symbols!\n", stderr);
-        retval = 6;
+        FILE *definitionFile = headerFile ? headerFile : outputFile;
+
+        if (config.text)
+            fputs("#include <string_view>\n\n", definitionFile);
+        else
+            fputs("#include <array>\n#include <cstdint>\n\n", definitionFile);
+
+        if (ferror(definitionFile))
+        {
+            fputs("Failed to write the includes!\n", stderr);
+            retval = 4;
+            goto RETURN;
+        }
+    }
+
+    /* Write the decompression runtime where the accessors are declared */
+    if (config.compress)
+    {
+        FILE *runtimeFile = headerFile ? headerFile : outputFile;
+
+        if (!writeRuntime(runtimeFile))
+        {
+            fputs("Failed to write the decompression runtime!\n", stderr);
+            retval = 4;
+            goto RETURN;
+        }
+    }
+
+    /* The constexpr definitions all go in the header (if any) */
+    if (config.cxxConstexpr && headerFile)
+        definitionOutput = NULL;
+    else
+        definitionOutput = outputFile;
+
+    /* The embedded paths are relative to the file holding the definitions */
+    if (config.embed && !setupEmbedDirectory(output ? output : header))
+    {
+        fputs("Failed to find the directory of the output file!\n", stderr);
+        retval = 3;
         goto RETURN;
     }
-    if (config.createMacro)
+
+    /* Open the pack file and write its runtime in the implementation */
+    if (pack)
     {
-        if ((symbolMacro = malloc(FILENAME_MAX)) == NULL)
+        const char *packName;
+
+        if ((packFile = fopen(pack, "wb")) == NULL)
         {
-            fputs("Failed to allocate memory for the symbols!\n", stderr);
-            retval = 6;
+            fprintf(stderr, "Failed to open the pack file: %s!\n", pack);
+            retval = 3;
             goto RETURN;
         }
+
+#ifdef _WIN32
+        packName = PathFindFileName(pack);
+        retval = writePackPreamble(definitionOutput ? definitionOutput : headerFile, packName);
+#else
+        /* The name is found without basename, which may modify its argument */
+        packName = strrchr(pack, '/');
+        retval = writePackPreamble(definitionOutput ? definitionOutput : headerFile, packName ? packName + 1 : pack);
+#endif
+        if (retval != 0)
+            goto RETURN;
     }
 
-    /* Process all files */
-    for (i = files; i < argc; i++)
+    /* Process all files (the pack is written in order) */
+    if (config.jobs != 1 && !packFile)
+        retval = processParallel(argv + files, argc - files, definitionOutput, headerFile, outputCXX, headerCXX, jobserver);
+    else
     {
+        for (i = files; i < argc; i++)
+        {
 #ifdef _WIN32
-        rv2 = process(argv[i], PathFindFileName(argv[i]), outputFile, headerFile, outputCXX, headerCXX);
+            rv2 = process(argv[i], PathFindFileName(argv[i]), definitionOutput, headerFile, outputCXX, headerCXX);
 #else
-        rv2 = process(argv[i], basename(argv[i]), outputFile, headerFile, outputCXX, headerCXX);
+            rv2 = process(argv[i], basename(argv[i]), definitionOutput, headerFile, outputCXX, headerCXX);
 #endif
-        if (rv2 != 0 && retval == 0)
-            retval = rv2;
+            if (rv2 != 0 && retval == 0)
+                retval = rv2;
+        }
     }
 
+    /* Write the functions mapping the pack */
+    if (packFile && retval == 0)
+        retval = writePackLoader(definitionOutput, headerFile, ftell(packFile));
+
   RETURN:
 
     /* Close the opened files */
     if (outputFile)
         fclose(outputFile);
 
+    if (packFile)
+        fclose(packFile);
+
     if (headerFile)
     {
         /* Write the end of the header guard */
@@ -391,8 +594,7 @@ int main(int argc, char **argv)
         fclose(headerFile);
     }
 
-    free(symbol);
-    free(symbolMacro);
+    jobserverClose();
 
     return retval;
 }
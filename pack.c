@@ -0,0 +1,142 @@
+/*
+ * Author: Matthieu Carteron <rubisetcie@gmail.com>
+ * date:   2024-08-24
+ *
+ * Provides the runtime loading the pack files.
+ */
+
+#include <stdio.h>
+
+#include "pack.h"
+
+/* Source code of the pack runtime */
+static const char *const runtime[] =
+{
+    "#include <stddef.h>",
+    "#ifdef _WIN32",
+    "#include <windows.h>",
+    "#else",
+    "#include <fcntl.h>",
+    "#include <unistd.h>",
+    "#include <sys/mman.h>",
+    "#include <sys/stat.h>",
+    "#endif",
+    "",
+    "#ifndef BINCLUDE_PACK_DEFINED",
+    "#define BINCLUDE_PACK_DEFINED",
+    "",
+    "#ifndef BINCLUDE_INLINE",
+    "#if defined(__cplusplus) || (defined(__STDC_VERSION__) && __STDC_VERSION__ >= 199901L)",
+    "#define BINCLUDE_INLINE static inline",
+    "#else",
+    "#define BINCLUDE_INLINE static",
+    "#endif",
+    "#endif",
+    "",
+    "/* Mapping of a pack file */",
+    "typedef struct binclude_pack",
+    "{",
+    "    const unsigned char *data; /* Content of the pack (NULL if not mapped) */",
+    "    size_t size;               /* Size of the pack */",
+    "} binclude_pack;",
+    "",
+    "/* Map a pack file of the expected size in memory, return 0 on success */",
+    "BINCLUDE_INLINE int binclude_pack_map(binclude_pack *pack, const char *path, size_t size)",
+    "{",
+    "    /* An empty file can't be mapped, but it's still a valid pack */",
+    "    static const unsigned char empty[1] = { 0 };",
+    "#ifdef _WIN32",
+    "    HANDLE file, mapping;",
+    "    LARGE_INTEGER fileSize;",
+    "",
+    "    if ((file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL)) == INVALID_HANDLE_VALUE)",
+    "        return -1;",
+    "",
+    "    if (!GetFileSizeEx(file, &fileSize) || (size_t)fileSize.QuadPart != size)",
+    "    {",
+    "        CloseHandle(file);",
+    "        return -1;",
+    "    }",
+    "",
+    "    if (size == 0)",
+    "    {",
+    "        CloseHandle(file);",
+    "        pack->data = empty;",
+    "        pack->size = 0;",
+    "        return 0;",
+    "    }",
+    "",
+    "    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);",
+    "    CloseHandle(file);",
+    "    if (mapping == NULL)",
+    "        return -1;",
+    "",
+    "    pack->data = (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);",
+    "    CloseHandle(mapping);",
+    "    if (pack->data == NULL)",
+    "        return -1;",
+    "#else",
+    "    struct stat status;",
+    "    void *data;",
+    "    int file;",
+    "",
+    "    if ((file = open(path, O_RDONLY)) < 0)",
+    "        return -1;",
+    "",
+    "    if (fstat(file, &status) != 0 || (size_t)status.st_size != size)",
+    "    {",
+    "        close(file);",
+    "        return -1;",
+    "    }",
+    "",
+    "    if (size == 0)",
+    "    {",
+    "        close(file);",
+    "        pack->data = empty;",
+    "        pack->size = 0;",
+    "        return 0;",
+    "    }",
+    "",
+    "    data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, file, 0);",
+    "    close(file);",
+    "    if (data == MAP_FAILED)",
+    "        return -1;",
+    "",
+    "    pack->data = (const unsigned char *)data;",
+    "#endif",
+    "    pack->size = size;",
+    "    return 0;",
+    "}",
+    "",
+    "/* Unmap a pack file (its content must not be used anymore) */",
+    "BINCLUDE_INLINE void binclude_pack_unmap(binclude_pack *pack)",
+    "{",
+    "    if (pack->data == NULL)",
+    "        return;",
+    "    if (pack->size > 0)",
+    "    {",
+    "#ifdef _WIN32",
+    "        UnmapViewOfFile(pack->data);",
+    "#else",
+    "        munmap((void *)pack->data, pack->size);",
+    "#endif",
+    "    }",
+    "    pack->data = NULL;",
+    "}",
+    "",
+    "#endif",
+    "",
+    NULL
+};
+
+/* Write the source code of the pack runtime */
+bool writePackRuntime(FILE *file)
+{
+    size_t i;
+    for (i = 0; runtime[i] != NULL; i++)
+    {
+        fputs(runtime[i], file);
+        fputc('\n', file);
+    }
+    return !ferror(file);
+}
@@ -0,0 +1,16 @@
+/*
+ * Author: Matthieu Carteron <rubisetcie@gmail.com>
+ * date:   2024-08-24
+ *
+ * Provides the runtime loading the pack files.
+ */
+
+#ifndef PACK_H_INCLUDED
+#define PACK_H_INCLUDED
+
+#include <stdio.h>
+#include <stdbool.h>
+
+bool writePackRuntime(FILE *file);
+
+#endif
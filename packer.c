@@ -10,12 +10,47 @@
 #include <ctype.h>
 
 #include "packer.h"
+#include "compress.h"
+#include "checksum.h"
+#include "pack.h"
+#include "transform.h"
+#include "embed.h"
 #include "config.h"
 #include "format.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#define HAVE_SSE2
+#endif
+
+/* Size of the chunks read from the input */
+#define READ_BUFFER_SIZE 65536
+
+/* Number of bytes checked one by one before scanning for escapes by blocks */
+#define SHORT_RUN 16
+
+/* Storage of the working variables (the files can be processed in parallel) */
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
 /* Configuration */
 extern Config config;
 
+/* Symbol names of the current file */
+static THREAD_LOCAL char symbol[FILENAME_MAX], symbolMacro[FILENAME_MAX];
+
+/* Pack file receiving the data (if packing) */
+extern FILE *packFile;
+
+/* Symbol names of the pack */
+static char packMapping[FILENAME_MAX + 16], packOpen[FILENAME_MAX + 16], packClose[FILENAME_MAX + 16];
+
 /* Make symbol name from file name (snake case) */
 static void setupSymbolSnake(const char *name, char *symbol)
 {
@@ -111,26 +146,58 @@ static void setupSymbolMacro(const char *name, char *symbol)
     symbol[j] = '\0';
 }
 
-/* Write all the content of the input file to the output, in numerical form */
-static bool writeDataNumerical(FILE *input, FILE *output, const size_t length)
+/* Write a chunk of data in dense numerical form: shortest decimal, no spaces and long lines */
+static bool writeBytesDense(const unsigned char *data, const size_t length, const size_t offset, FILE *output)
 {
-    int i, n, byte;
-    bool first = true;
-    for (i = 0, n = 0; i < length; i++)
+    char buffer[4096];
+    size_t i, used = 0;
+    unsigned char byte;
+
+    for (i = 0; i < length; i++)
     {
-        byte = fgetc(input);
-        if (byte == EOF)
-            return false;
+        /* Write the separator */
+        if (offset + i > 0)
+        {
+            buffer[used++] = ',';
+            if (!config.singleLine && (offset + i) % DENSE_PER_LINE == 0)
+                buffer[used++] = '\n';
+        }
+
+        /* Format the byte without leading zeros */
+        byte = data[i];
+        if (byte >= 100)
+            buffer[used++] = '0' + byte / 100;
+        if (byte >= 10)
+            buffer[used++] = '0' + byte / 10 % 10;
+        buffer[used++] = '0' + byte % 10;
 
+        /* Flush the buffer before it can overflow */
+        if (used > sizeof(buffer) - 8)
+        {
+            if (fwrite(buffer, 1, used, output) != used)
+                return false;
+            used = 0;
+        }
+    }
+    return fwrite(buffer, 1, used, output) == used;
+}
+
+/* Write a chunk of data in numerical form (offset is the index of its first byte in the data) */
+static bool writeBytesNumerical(const unsigned char *data, const size_t length, const size_t offset, FILE *output)
+{
+    size_t i;
+
+    if (config.dense)
+        return writeBytesDense(data, length, offset, output);
+
+    for (i = 0; i < length; i++)
+    {
         /* Write the separator */
-        if (!first)
+        if (offset + i > 0)
         {
             fputs(",", output);
-            if (!config.singleLine && n >= DATA_PER_LINE)
-            {
+            if (!config.singleLine && (offset + i) % DATA_PER_LINE == 0)
                 fputs("\n" DATA_INDENT, output);
-                n = 0;
-            }
             else
                 fputs(" ", output);
 
@@ -141,81 +208,764 @@ static bool writeDataNumerical(FILE *input, FILE *output, const size_t length)
         /* Format the byte */
         switch (config.format)
         {
-            case F_DECIMAL: fprintf(output, "%d", byte);     break;
-            default:        fprintf(output, "0x%02x", byte); break;
+            case F_DECIMAL: fprintf(output, "%d", data[i]);     break;
+            default:        fprintf(output, "0x%02x", data[i]); break;
         }
         if (ferror(output))
             return false;
-
-        first = false;
-        n++;
     }
     return true;
 }
 
-/* Write all the content of the input file to the output, in text form */
-static bool writeDataText(FILE *input, FILE *output, const size_t length)
+#ifdef HAVE_SSE2
+/* Find the index of the lowest bit set in a non-zero mask */
+static unsigned int lowestBit(unsigned int mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(mask);
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    unsigned int index = 0;
+    while ((mask & 1) == 0)
+    {
+        mask >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+#endif
+
+/* Bytes that have to be escaped in text form: the null byte, the control characters from '\a' to '\r', '"' and '\\' */
+static const unsigned char escapedBytes[256] =
+{
+    1, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0
+};
+
+/* Find the offset of the next byte that has to be escaped (or the length if none) */
+static size_t scanEscape(const unsigned char *data, const size_t length)
 {
-    int i, byte;
-    bool newLine = false;
+    size_t i = 0;
+
+    /* The runs of structured text are short: check the first bytes one by one */
+    for (; i < length && i < SHORT_RUN; i++)
+    {
+        if (escapedBytes[data[i]])
+            return i;
+    }
+#ifdef HAVE_SSE2
+    const __m128i first = _mm_set1_epi8('\a');
+    const __m128i range = _mm_set1_epi8('\r' - '\a');
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i zero = _mm_setzero_si128();
+    __m128i chunk, shifted, mask;
+    unsigned int bits;
+
+    /* Check 16 bytes at a time */
+    for (; i + 16 <= length; i += 16)
+    {
+        chunk = _mm_loadu_si128((const __m128i*)(data + i));
+
+        /* A byte is in the control range if min(byte - '\a', range) equals itself */
+        shifted = _mm_sub_epi8(chunk, first);
+        mask = _mm_cmpeq_epi8(_mm_min_epu8(shifted, range), shifted);
+        mask = _mm_or_si128(mask, _mm_cmpeq_epi8(chunk, quote));
+        mask = _mm_or_si128(mask, _mm_cmpeq_epi8(chunk, backslash));
+        mask = _mm_or_si128(mask, _mm_cmpeq_epi8(chunk, zero));
+
+        bits = (unsigned int)_mm_movemask_epi8(mask);
+        if (bits != 0)
+            return i + lowestBit(bits);
+    }
+#endif
+
+    /* Check the remaining bytes one by one */
+    for (; i < length; i++)
+    {
+        if (escapedBytes[data[i]])
+            return i;
+    }
+    return length;
+}
+
+/* Write a chunk of data in text form */
+static bool writeBytesText(const unsigned char *data, const size_t length, FILE *output)
+{
+    static const char lineBreak[] = "\"\n" DATA_INDENT "\"";
+    char buffer[16384];
+    size_t i, run, used = 0;
+    const char *escape;
+    bool newLine;
+
     for (i = 0; i < length; i++)
     {
-        byte = fgetc(input);
-        if (byte == EOF)
-            return false;
+        /* Copy the plain characters at once */
+        run = scanEscape(data + i, length - i);
+        if (run > 0)
+        {
+            if (used + run > sizeof(buffer))
+            {
+                if (fwrite(buffer, 1, used, output) != used)
+                    return false;
+                used = 0;
+            }
+
+            /* The runs larger than the buffer are written directly */
+            if (run > sizeof(buffer))
+            {
+                if (fwrite(data + i, 1, run, output) != run)
+                    return false;
+            }
+            else
+            {
+                memcpy(buffer + used, data + i, run);
+                used += run;
+            }
+
+            i += run;
+            if (i >= length)
+                break;
+        }
+
+        /* Flush the buffer before an escape sequence and a line break can overflow it */
+        if (used + 8 + sizeof(lineBreak) > sizeof(buffer))
+        {
+            if (fwrite(buffer, 1, used, output) != used)
+                return false;
+            used = 0;
+        }
 
         /* Handle the escape sequences */
-        switch (byte)
+        newLine = false;
+        switch (data[i])
         {
             case '\n':
-                fputs("\\n", output);
+                escape = "\\n";
                 newLine = true;
                 break;
             case '\r':
-                fputs("\\r", output);
+                escape = "\\r";
                 newLine = true;
                 break;
-            case '\a': fputs("\\a", output);  break;
-            case '\b': fputs("\\b", output);  break;
-            case '\f': fputs("\\f", output);  break;
-            case '\t': fputs("\\t", output);  break;
-            case '\v': fputs("\\v", output);  break;
-            case '"' : fputs("\\\"", output); break;
-            case '\\': fputs("\\\\", output); break;
-            default  : fputc(byte, output);   break;
+            case '\a': escape = "\\a";   break;
+            case '\b': escape = "\\b";   break;
+            case '\f': escape = "\\f";   break;
+            case '\t': escape = "\\t";   break;
+            case '\v': escape = "\\v";   break;
+            case '"' : escape = "\\\"";  break;
+            case '\\': escape = "\\\\";  break;
+            default:   escape = "\\000"; break;
         }
 
-        if (ferror(output))
-            return false;
+        while (*escape != '\0')
+            buffer[used++] = *escape++;
 
         /* Handle new lines */
         if (!config.singleLine && newLine)
         {
-            fputs("\"\n" DATA_INDENT "\"", output);
-            if (ferror(output))
-                return false;
-            newLine = false;
+            memcpy(buffer + used, lineBreak, sizeof(lineBreak) - 1);
+            used += sizeof(lineBreak) - 1;
         }
     }
-    return true;
+    return fwrite(buffer, 1, used, output) == used;
 }
 
-/* Write all the content of the input file to the output, in text form */
-static bool writeData(FILE *input, FILE *output, const size_t length)
+/* Write a chunk of data (offset is the index of its first byte in the data) */
+static bool writeBytes(const unsigned char *data, const size_t length, const size_t offset, FILE *output)
 {
     if (config.text)
-        return writeDataText(input, output, length);
+        return writeBytesText(data, length, output);
+
+    return writeBytesNumerical(data, length, offset, output);
+}
+
+/* Count the zero bytes ending the input (the position is rewound afterwards) */
+static long countTrailingZeros(FILE *input, const long length)
+{
+    static THREAD_LOCAL unsigned char buffer[READ_BUFFER_SIZE];
+    long start, end = length, count = 0;
+    size_t i, size;
+
+    /* Read the input backward, chunk by chunk */
+    while (end > 0)
+    {
+        start = end > READ_BUFFER_SIZE ? end - READ_BUFFER_SIZE : 0;
+        size = end - start;
+
+        if (fseek(input, start, SEEK_SET) != 0 || fread(buffer, 1, size, input) != size)
+        {
+            count = 0;
+            break;
+        }
+
+        /* Count the zeros from the end of the chunk */
+        for (i = size; i > 0 && buffer[i - 1] == 0; i--);
+        count += size - i;
+
+        if (i > 0)
+            break;
+        end = start;
+    }
+
+    rewind(input);
+    return count;
+}
+
+/* Write all the content of the input file to the output if any (and add it to the checksums if any) */
+static bool writeData(FILE *input, FILE *output, const size_t length, Checksum *checksum)
+{
+    static THREAD_LOCAL unsigned char buffer[READ_BUFFER_SIZE];
+    size_t offset = 0, filled;
+
+    while (offset < length)
+    {
+        filled = fread(buffer, 1, length - offset < READ_BUFFER_SIZE ? length - offset : READ_BUFFER_SIZE, input);
+        if (filled == 0)
+            return false;
+
+        if (output && !writeBytes(buffer, filled, offset, output))
+            return false;
+
+        if (checksum)
+            checksumUpdate(checksum, buffer, filled);
+
+        offset += filled;
+    }
+    return true;
+}
+
+/* Add zero bytes to the checksums */
+static void addZeros(Checksum *checksum, size_t count)
+{
+    static const unsigned char zeros[READ_BUFFER_SIZE] = { 0 };
+    while (count > 0)
+    {
+        const size_t size = count < READ_BUFFER_SIZE ? count : READ_BUFFER_SIZE;
+        checksumUpdate(checksum, zeros, size);
+        count -= size;
+    }
+}
+
+/* Write the name of a constant derived from the data symbol */
+static void writeConstantSymbol(FILE *file, const char *suffix, const char *suffixCamel, const char *suffixMacro)
+{
+    if (config.createMacro)
+        fprintf(file, "%s_%s", symbolMacro, suffixMacro);
+    else if (config.camelCase)
+        fprintf(file, "%s%s", symbol, suffixCamel);
+    else
+        fprintf(file, "%s_%s", symbol, suffix);
+}
+
+/* Write the name of the size symbol */
+static void writeSizeSymbol(FILE *file)
+{
+    writeConstantSymbol(file, SIZE_SUFFIX, SIZE_SUFFIX_CAMEL, SIZE_SUFFIX_MACRO);
+}
+
+/* Write a constant definition (or declaration if external) */
+static bool writeConstantDefinition(FILE *file, const bool isExtern, const char *type, const char *suffix, const char *suffixCamel, const char *suffixMacro, const char *value)
+{
+    if (config.createMacro)
+    {
+        fputs("#define ", file);
+        writeConstantSymbol(file, suffix, suffixCamel, suffixMacro);
+        fprintf(file, " %s\n", value);
+    }
+    else
+    {
+        if (isExtern)
+            fputs("extern ", file);
+
+        if (config.cxxConstexpr)
+            fprintf(file, "inline constexpr %s ", type);
+        else
+            fprintf(file, "const %s ", type);
+
+        writeConstantSymbol(file, suffix, suffixCamel, suffixMacro);
+
+        if (isExtern)
+            fputs(";\n", file);
+        else
+            fprintf(file, " = %s;\n", value);
+    }
+    return !ferror(file);
+}
+
+/* Write the size definition (or declaration if external) */
+static bool writeSizeDefinition(FILE *file, const bool isExtern, const long length)
+{
+    char value[32];
+    sprintf(value, "%ld", length);
+    return writeConstantDefinition(file, isExtern, SIZE_TYPE, SIZE_SUFFIX, SIZE_SUFFIX_CAMEL, SIZE_SUFFIX_MACRO, value);
+}
+
+/* Write the checksum definitions (or declarations if external) */
+static bool writeChecksumDefinitions(FILE *file, const bool isExtern, const Checksum *checksum)
+{
+    char crcValue[32], hashValue[32];
+    uint32_t crc;
+    uint64_t hash;
+
+    checksumFinal(checksum, &crc, &hash);
+    sprintf(crcValue, "0x%08lxUL", (unsigned long)crc);
+    sprintf(hashValue, "0x%08lx%08lxULL", (unsigned long)(hash >> 32), (unsigned long)(hash & 0xffffffffUL));
+
+    return writeConstantDefinition(file, isExtern, CRC_TYPE, CRC_SUFFIX, CRC_SUFFIX_CAMEL, CRC_SUFFIX_MACRO, crcValue) &&
+           writeConstantDefinition(file, isExtern, HASH_TYPE, HASH_SUFFIX, HASH_SUFFIX_CAMEL, HASH_SUFFIX_MACRO, hashValue);
+}
+
+/* Write the declaration of the data symbol */
+static void writeDeclaration(FILE *file, const bool isExtern, const long length)
+{
+    /* The C++ constexpr types carry the size */
+    if (config.cxxConstexpr)
+    {
+        if (config.text)
+            fprintf(file, "inline constexpr std::string_view %s", symbol);
+        else
+        {
+            fputs("inline constexpr std::array<" CXX_DATA_TYPE ", ", file);
+            writeSizeSymbol(file);
+            fprintf(file, "> %s", symbol);
+        }
+        return;
+    }
+
+    if (isExtern)
+        fputs("extern ", file);
+
+    fprintf(file, "const " DATA_TYPE " %s[", symbol);
+    if (config.createMacro)
+        writeSizeSymbol(file);
+    else
+        fprintf(file, "%ld", length);
+    fputs("]", file);
+}
+
+/* Open the braces of an initializer */
+static void writeBraceOpening(FILE *file)
+{
+    if (config.singleLine)
+        fputs(" { ", file);
+    else if (!config.allman)
+        fputs(" {\n" DATA_INDENT, file);
+    else
+        fputs("\n{\n" DATA_INDENT, file);
+}
+
+/* Close the braces of an initializer */
+static void writeBraceClosing(FILE *file)
+{
+    if (config.singleLine)
+        fputs(" };\n\n", file);
+    else
+        fputs("\n};\n\n", file);
+}
+
+/* Write the definition of the data symbol loaded by the compiler (the byte list being the fallback) */
+static int writeEmbedded(FILE *file, const char *filename, FILE *input, const long length, const long dataLength, Checksum *checksum)
+{
+    char path[FILENAME_MAX];
+
+    if (!setupEmbedPath(filename, path))
+    {
+        fprintf(stderr, "Failed to make up the embedded path of the input file: %s!\n", filename);
+        return 4;
+    }
+
+    /* The path is written as a header name, which has no escape sequences */
+    if (strpbrk(path, "\"\\\n\r") != NULL)
+    {
+        fprintf(stderr, "The path of the input file can't be written in #embed: %s!\n", filename);
+        return 4;
+    }
+
+    /* Check if the compiler can embed the file (the check must be nested for the older preprocessors) */
+    fprintf(file, "#if defined(__has_embed)\n#if __has_embed(\"%s\")\n#define %s_" EMBED_SUFFIX "\n#endif\n#endif\n", path, symbolMacro);
+
+    writeDeclaration(file, false, length);
+
+    if (!config.allman)
+        fputs(" = {\n", file);
+    else
+        fputs(" =\n{\n", file);
+
+    fprintf(file, "#ifdef %s_" EMBED_SUFFIX "\n#embed \"%s\"\n#else\n", symbolMacro, path);
+
+    if (ferror(file))
+    {
+        fputs("Failed to write the definition!\n", stderr);
+        return 5;
+    }
+
+    /* Write the byte list for the other compilers, or still read the data for the checksums */
+    if (config.embedFallback)
+    {
+        fputs(DATA_INDENT, file);
+        if (!writeData(input, file, dataLength, checksum))
+        {
+            fputs("Failed to write the data!\n", stderr);
+            return 5;
+        }
+        fputs("\n", file);
+    }
+    else
+    {
+        fprintf(file, "#error \"The compiler can't embed the file: %s\"\n", path);
+        if (checksum && !writeData(input, NULL, dataLength, checksum))
+        {
+            fputs("Failed to read the data!\n", stderr);
+            return 5;
+        }
+    }
+
+    fputs("#endif\n};\n\n", file);
+
+    if (ferror(file))
+    {
+        fputs("Failed to write the closure!\n", stderr);
+        return 5;
+    }
+    return 0;
+}
+
+/* Write the complete definition of the data symbol */
+static int writeDefinition(FILE *file, const char *filename, FILE *input, const long length, const long dataLength, Checksum *checksum)
+{
+    if (config.embed)
+        return writeEmbedded(file, filename, input, length, dataLength, checksum);
+
+    writeDeclaration(file, false, length);
+
+    /* Open the initializer (the string view is built from the literal and the size) */
+    if (!config.cxxConstexpr || !config.text)
+        fputs(" =", file);
+
+    if (!config.text || config.cxxConstexpr)
+    {
+        writeBraceOpening(file);
+
+        if (config.text)
+            fputs("\"", file);
+    }
+    else
+    {
+        if (config.singleLine)
+            fputs(" \"", file);
+        else
+            fputs("\n" DATA_INDENT "\"", file);
+    }
+
+    if (ferror(file))
+    {
+        fputs("Failed to write the definition!\n", stderr);
+        return 5;
+    }
+
+    /* Write the data */
+    if (!writeData(input, file, dataLength, checksum))
+    {
+        fputs("Failed to write the data!\n", stderr);
+        return 5;
+    }
+
+    /* Close the initializer */
+    if (!config.text)
+        writeBraceClosing(file);
+    else if (config.cxxConstexpr)
+    {
+        if (config.singleLine)
+            fputs("\", ", file);
+        else
+            fputs("\",\n" DATA_INDENT, file);
+
+        writeSizeSymbol(file);
+        writeBraceClosing(file);
+    }
+    else
+        fputs("\";\n\n", file);
+
+    if (ferror(file))
+    {
+        fputs("Failed to write the closure!\n", stderr);
+        return 5;
+    }
+    return 0;
+}
+
+/* Make up the name of a symbol derived from the data symbol */
+static void setupSymbolSuffixed(char *buffer, const char *snakeSuffix, const char *camelSuffix)
+{
+    if (config.camelCase)
+        sprintf(buffer, "%s%s", symbol, camelSuffix);
+    else
+        sprintf(buffer, "%s_%s", symbol, snakeSuffix);
+}
+
+/* Write the compressed data and its accessors (the runtime is written beforehand) */
+static int writeCompressed(FILE *input, const long length, FILE *output, FILE *header, Checksum *checksum)
+{
+    char compressedName[FILENAME_MAX + 16], cacheName[FILENAME_MAX + 16], storedName[FILENAME_MAX + 16];
+    char getName[FILENAME_MAX + 16], releaseName[FILENAME_MAX + 16], streamName[FILENAME_MAX + 16];
+    unsigned char *data = NULL, *compressed = NULL;
+    size_t compressedLength;
+    int retval = 0;
+
+    /* The implementation goes in the source if any, otherwise the accessors are local to the header */
+    FILE *file = output ? output : header;
+    const char *linkage = output ? "" : "BINCLUDE_INLINE ";
+
+    setupSymbolSuffixed(compressedName, "compressed", "Compressed");
+    setupSymbolSuffixed(cacheName, "cache", "Cache");
+    setupSymbolSuffixed(storedName, "stored", "Stored");
+    setupSymbolSuffixed(getName, "get", "Get");
+    setupSymbolSuffixed(releaseName, "release", "Release");
+    setupSymbolSuffixed(streamName, "stream", "Stream");
+
+    /* Read and compress the whole input */
+    if ((data = malloc(length > 0 ? length : 1)) == NULL || (compressed = malloc(COMPRESS_BOUND(length))) == NULL)
+    {
+        fputs("Failed to allocate memory for the compression!\n", stderr);
+        retval = 6;
+        goto RETURN;
+    }
+    if (fread(data, 1, length, input) != (size_t)length)
+    {
+        fputs("Failed to read the data!\n", stderr);
+        retval = 5;
+        goto RETURN;
+    }
+    if (checksum)
+        checksumUpdate(checksum, data, length);
+
+    if (!compress(data, length, compressed, &compressedLength))
+    {
+        fputs("Failed to compress the data!\n", stderr);
+        retval = 6;
+        goto RETURN;
+    }
+
+    /* Store the data as is if it doesn't get smaller (the accessors then need no cache) */
+    if (length > 0 && compressedLength >= (size_t)length)
+    {
+        fprintf(file, "static const " DATA_TYPE " %s[%ld] =", storedName, length);
+        writeBraceOpening(file);
+        if (!writeBytesNumerical(data, length, 0, file))
+        {
+            fputs("Failed to write the data!\n", stderr);
+            retval = 5;
+            goto RETURN;
+        }
+        writeBraceClosing(file);
+
+        fprintf(file, "%sconst unsigned char *%s(void) { return %s; }\n", linkage, getName, storedName);
+        fprintf(file, "%svoid %s(void) { }\n", linkage, releaseName);
+        fprintf(file, "%svoid %s(binclude_stream *stream) { binclude_stream_init_stored(stream, %s, %ld); }\n\n", linkage, streamName, storedName, length);
+    }
+    else
+    {
+        /* Write the compressed data */
+        fprintf(file, "static const " DATA_TYPE " %s[%lu] =", compressedName, (unsigned long)compressedLength);
+        writeBraceOpening(file);
+        if (!writeBytesNumerical(compressed, compressedLength, 0, file))
+        {
+            fputs("Failed to write the data!\n", stderr);
+            retval = 5;
+            goto RETURN;
+        }
+        writeBraceClosing(file);
+
+        /* Write the cache and the accessors */
+        fprintf(file, "static unsigned char *%s = NULL;\n", cacheName);
+        fprintf(file, "%sconst unsigned char *%s(void) { return binclude_acquire(&%s, %s, %lu, %ld); }\n", linkage, getName, cacheName, compressedName, (unsigned long)compressedLength, length);
+        fprintf(file, "%svoid %s(void) { binclude_release(&%s); }\n", linkage, releaseName, cacheName);
+        fprintf(file, "%svoid %s(binclude_stream *stream) { binclude_stream_init(stream, %s, %lu); }\n\n", linkage, streamName, compressedName, (unsigned long)compressedLength);
+    }
+
+    if (ferror(file))
+    {
+        fputs("Failed to write the accessors!\n", stderr);
+        retval = 5;
+        goto RETURN;
+    }
+
+    /* Declare the accessors in the header */
+    if (output && header)
+    {
+        fprintf(header, "const unsigned char *%s(void);\n", getName);
+        fprintf(header, "void %s(void);\n", releaseName);
+        fprintf(header, "void %s(binclude_stream *stream);\n\n", streamName);
+
+        if (ferror(header))
+        {
+            fputs("Failed to write the declaration!\n", stderr);
+            retval = 5;
+            goto RETURN;
+        }
+    }
+
+  RETURN:
+
+    free(data);
+    free(compressed);
+
+    return retval;
+}
+
+/* Append the data to the pack file, then write its offset and accessor */
+static int writePacked(FILE *input, const long length, FILE *output, FILE *header, const bool implementation, Checksum *checksum)
+{
+    static THREAD_LOCAL unsigned char buffer[READ_BUFFER_SIZE];
+    char getName[FILENAME_MAX + 16], value[32];
+    size_t remaining, filled;
+    long offset;
+
+    /* The implementation goes in the source if any, otherwise the accessor is local to the header */
+    FILE *file = output ? output : header;
+    const char *linkage = output ? "" : "BINCLUDE_INLINE ";
+
+    /* Align the data in the pack */
+    for (offset = ftell(packFile); offset % PACK_ALIGN != 0; offset++)
+        fputc(0, packFile);
+
+    /* Copy the data */
+    for (remaining = length; remaining > 0; remaining -= filled)
+    {
+        filled = fread(buffer, 1, remaining < READ_BUFFER_SIZE ? remaining : READ_BUFFER_SIZE, input);
+        if (filled == 0)
+        {
+            fputs("Failed to read the data!\n", stderr);
+            return 5;
+        }
+
+        fwrite(buffer, 1, filled, packFile);
+        if (checksum)
+            checksumUpdate(checksum, buffer, filled);
+    }
+
+    if (ferror(packFile))
+    {
+        fputs("Failed to write the data in the pack!\n", stderr);
+        return 5;
+    }
+
+    /* Write the offset definition */
+    sprintf(value, "%ld", offset);
+    if (output && (!config.createMacro || !header))
+    {
+        if (!writeConstantDefinition(output, false, SIZE_TYPE, OFFSET_SUFFIX, OFFSET_SUFFIX_CAMEL, OFFSET_SUFFIX_MACRO, value))
+        {
+            fputs("Failed to write the offset definition!\n", stderr);
+            return 5;
+        }
+    }
+    if (header)
+    {
+        if (!writeConstantDefinition(header, !implementation, SIZE_TYPE, OFFSET_SUFFIX, OFFSET_SUFFIX_CAMEL, OFFSET_SUFFIX_MACRO, value))
+        {
+            fputs("Failed to write the offset definition!\n", stderr);
+            return 5;
+        }
+    }
+
+    /* Write the accessor (NULL until the pack is mapped) */
+    setupSymbolSuffixed(getName, "get", "Get");
+    fprintf(file, "%sconst unsigned char *%s(void) { return %s.data ? %s.data + %ld : NULL; }\n\n", linkage, getName, packMapping, packMapping, offset);
 
-    return writeDataNumerical(input, output, length);
+    if (ferror(file))
+    {
+        fputs("Failed to write the accessor!\n", stderr);
+        return 5;
+    }
+
+    if (output && header)
+    {
+        fprintf(header, "const unsigned char *%s(void);\n\n", getName);
+
+        if (ferror(header))
+        {
+            fputs("Failed to write the declaration!\n", stderr);
+            return 5;
+        }
+    }
+    return 0;
+}
+
+/* Write the pack runtime and the mapping of the pack */
+int writePackPreamble(FILE *file, const char *name)
+{
+    /* Make up the symbol names from the pack name */
+    if (config.camelCase)
+        setupSymbolCamel(name, symbol);
+    else
+        setupSymbolSnake(name, symbol);
+
+    setupSymbolSuffixed(packMapping, "mapping", "Mapping");
+    setupSymbolSuffixed(packOpen, "open", "Open");
+    setupSymbolSuffixed(packClose, "close", "Close");
+
+    if (!writePackRuntime(file))
+    {
+        fputs("Failed to write the pack runtime!\n", stderr);
+        return 4;
+    }
+
+    fprintf(file, "static binclude_pack %s = { NULL, 0 };\n\n", packMapping);
+    if (ferror(file))
+    {
+        fputs("Failed to write the pack mapping!\n", stderr);
+        return 4;
+    }
+    return 0;
+}
+
+/* Write the functions mapping the pack in memory */
+int writePackLoader(FILE *output, FILE *header, const long size)
+{
+    FILE *file = output ? output : header;
+    const char *linkage = output ? "" : "BINCLUDE_INLINE ";
+
+    /* Returns 0 if the pack is mapped */
+    fprintf(file, "%sint %s(const char *path) { return binclude_pack_map(&%s, path, %ld); }\n", linkage, packOpen, packMapping, size);
+    fprintf(file, "%svoid %s(void) { binclude_pack_unmap(&%s); }\n\n", linkage, packClose, packMapping);
+
+    if (ferror(file))
+    {
+        fputs("Failed to write the pack loader!\n", stderr);
+        return 5;
+    }
+
+    if (output && header)
+    {
+        fprintf(header, "int %s(const char *path);\n", packOpen);
+        fprintf(header, "void %s(void);\n\n", packClose);
+
+        if (ferror(header))
+        {
+            fputs("Failed to write the pack loader!\n", stderr);
+            return 5;
+        }
+    }
+    return 0;
 }
 
 /* Process an input file */
 int process(const char *filename, const char *name, FILE *output, FILE *header, bool outputCXX, bool headerCXX)
 {
-    extern char *symbol, *symbolMacro;
-    long length;
+    long length, dataLength;
     int retval = 0;
-    FILE *input = NULL;
+    Checksum checksumState, *checksum = NULL;
+    FILE *input = NULL, *transformed;
 
     /* If both the source and the header are specified, only implement in one file */
     const bool implementation = ((output == NULL) != (header == NULL));
@@ -255,7 +1005,7 @@ int process(const char *filename, const char *name, FILE *output, FILE *header,
         setupSymbolSnake(name, symbol);
 
     /* Make up the macro symbol name if needed */
-    if (config.createMacro)
+    if (config.createMacro || config.embed)
         setupSymbolMacro(name, symbolMacro);
 
     /* Open the input file */
@@ -266,6 +1016,19 @@ int process(const char *filename, const char *name, FILE *output, FILE *header,
         goto RETURN;
     }
 
+    /* Apply the transformations in a temporary file */
+    if (needsTransform(name))
+    {
+        if ((transformed = transform(input, name)) == NULL)
+        {
+            fprintf(stderr, "Failed to transform the input file: %s!\n", filename);
+            retval = 4;
+            goto RETURN;
+        }
+        fclose(input);
+        input = transformed;
+    }
+
     /* Compute the length of the file */
     fseek(input, 0, SEEK_END);
     length = ftell(input);
@@ -273,42 +1036,35 @@ int process(const char *filename, const char *name, FILE *output, FILE *header,
     /* Rewind to the start of the file */
     rewind(input);
 
-    /* Write the size definition */
-    if (output && !config.createMacro)
+    /* Leave the trailing zeros to the zero-fill of the array (keeping at least one initializer) */
+    dataLength = length;
+    if (config.trimZeros && !config.text && !config.compress)
     {
-        if (config.camelCase)
-            fprintf(output, "const " SIZE_TYPE " %s" SIZE_SUFFIX_CAMEL " = %d;\n", symbol, length);
-        else
-            fprintf(output, "const " SIZE_TYPE " %s_" SIZE_SUFFIX " = %d;\n", symbol, length);
+        dataLength -= countTrailingZeros(input, length);
+        if (dataLength == 0 && length > 0)
+            dataLength = 1;
+    }
 
-        if (ferror(output))
+    /* The checksums are only computed when requested */
+    if (config.checksum)
+    {
+        checksumInit(&checksumState);
+        checksum = &checksumState;
+    }
+
+    /* Write the size definition (the macro is defined in the header if any) */
+    if (output && (!config.createMacro || !header))
+    {
+        if (!writeSizeDefinition(output, false, length))
         {
             fputs("Failed to write the size definition!\n", stderr);
             retval = 5;
             goto RETURN;
         }
     }
-	if (header)
+    if (header)
     {
-        if (config.createMacro)
-            fprintf(header, "#define %s_" SIZE_SUFFIX_MACRO " %d\n", symbolMacro, length);
-        else
-        {
-            if (!implementation)
-                fputs("extern ", header);
-
-            if (config.camelCase)
-                fprintf(header, "const " SIZE_TYPE " %s" SIZE_SUFFIX_CAMEL, symbol);
-            else
-                fprintf(header, "const " SIZE_TYPE " %s_" SIZE_SUFFIX, symbol);
-
-            if (implementation)
-                fprintf(header, " = %d;\n", length);
-            else
-                fputs(";\n", header);
-        }
-
-        if (ferror(header))
+        if (!writeSizeDefinition(header, !implementation, length))
         {
             fputs("Failed to write the size definition!\n", stderr);
             retval = 5;
@@ -316,129 +1072,71 @@ int process(const char *filename, const char *name, FILE *output, FILE *header,
         }
     }
 
-    /* Write the content of the input */
-    if (output)
+    /* Write the compressed content of the input */
+    if (config.compress)
     {
-        /* Write the definition */
-        if (config.createMacro)
-            fprintf(output, "const " DATA_TYPE " %s[%s_" SIZE_SUFFIX_MACRO "] =", symbol, symbolMacro);
-        else
-            fprintf(output, "const " DATA_TYPE " %s[%d] =", symbol, length);
-
-        if (!config.text)
-        {
-            if (config.singleLine)
-                fputs(" { ", output);
-            else if (!config.allman)
-                fputs(" {\n" DATA_INDENT, output);
-            else
-                fputs("\n{\n" DATA_INDENT, output);
-        }
-        else
-        {
-            if (config.singleLine)
-                fputs(" \"", output);
-            else
-                fputs("\n" DATA_INDENT "\"", output);
-        }
-
-        if (ferror(output))
-        {
-            fputs("Failed to write the definition!\n", stderr);
-            retval = 5;
-            goto RETURN;
-        }
-
-        /* Write the data */
-        if (!writeData(input, output, length))
-        {
-            fputs("Failed to write the data!\n", stderr);
-            retval = 5;
+        if ((retval = writeCompressed(input, length, output, header, checksum)) != 0)
             goto RETURN;
-        }
-
-        /* Close the bracket */
-        if (!config.text)
-        {
-            if (config.singleLine)
-                fprintf(output, " };\n\n", symbol);
-            else
-                fprintf(output, "\n};\n\n", symbol);
-        }
-        else
-            fprintf(output, "\";\n\n", symbol);
-
-        if (ferror(output))
-        {
-            fputs("Failed to write the closure!\n", stderr);
-            retval = 5;
+    }
+    else if (packFile)
+    {
+        if ((retval = writePacked(input, length, output, header, implementation, checksum)) != 0)
             goto RETURN;
-        }
     }
-    if (header)
+    else
     {
-        /* Write the definition */
-        if (!implementation)
-            fputs("extern ", header);
-
-        if (config.createMacro)
-            fprintf(header, "const " DATA_TYPE " %s[%s_" SIZE_SUFFIX_MACRO "]", symbol, symbolMacro);
-        else
-            fprintf(header, "const " DATA_TYPE " %s[%d]", symbol, length);
-
-        if (implementation)
+        /* Write the content of the input */
+        if (output)
         {
-            if (!config.text)
+            if ((retval = writeDefinition(output, filename, input, length, dataLength, checksum)) != 0)
+                goto RETURN;
+        }
+        if (header)
+        {
+            if (implementation)
             {
-                if (config.singleLine)
-                    fputs(" { ", header);
-                else if (!config.allman)
-                    fputs(" {\n" DATA_INDENT, header);
-                else
-                    fputs("\n{\n" DATA_INDENT, header);
+                if ((retval = writeDefinition(header, filename, input, length, dataLength, checksum)) != 0)
+                    goto RETURN;
             }
             else
             {
-                if (config.singleLine)
-                    fputs(" \"", header);
-                else
-                    fputs("\n" DATA_INDENT "\"", header);
+                writeDeclaration(header, true, length);
+                fputs(";\n\n", header);
+
+                if (ferror(header))
+                {
+                    fputs("Failed to write the declaration!\n", stderr);
+                    retval = 5;
+                    goto RETURN;
+                }
             }
+        }
+
+        /* The trimmed zeros are part of the data nonetheless */
+        if (checksum)
+            addZeros(checksum, length - dataLength);
+    }
 
-            if (ferror(header))
+    /* Write the checksums computed along with the data */
+    if (config.checksum)
+    {
+        if (output && (!config.createMacro || !header))
+        {
+            if (!writeChecksumDefinitions(output, false, checksum) || fputs("\n", output) == EOF)
             {
-                fputs("Failed to write the definition!\n", stderr);
+                fputs("Failed to write the checksum definitions!\n", stderr);
                 retval = 5;
                 goto RETURN;
             }
-
-            /* Write the data */
-            if (!writeData(input, header, length))
+        }
+        if (header)
+        {
+            if (!writeChecksumDefinitions(header, !implementation, checksum) || fputs("\n", header) == EOF)
             {
-                fputs("Failed to write the data!\n", stderr);
+                fputs("Failed to write the checksum definitions!\n", stderr);
                 retval = 5;
                 goto RETURN;
             }
-
-            /* Close the bracket */
-            if (!config.text)
-            {
-                if (config.singleLine)
-                    fprintf(header, " };\n\n", symbol);
-                else
-                    fprintf(header, "\n};\n\n", symbol);
-            }
-            else
-                fprintf(output, "\";\n\n", symbol);
-        }
-        else
-            fputs(";\n\n", header);
-
-        if (ferror(header))
-        {
-            fputs("Failed to write the closure!\n", stderr);
-            retval = 5;
-            goto RETURN;
         }
     }
 
@@ -12,5 +12,7 @@
 #include <stdbool.h>
 
 int process(const char *filename, const char *name, FILE *output, FILE *header, bool outputCXX, bool headerCXX);
+int writePackPreamble(FILE *file, const char *name);
+int writePackLoader(FILE *output, FILE *header, const long size);
 
 #endif
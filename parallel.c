@@ -0,0 +1,297 @@
+/*
+ * Author: Matthieu Carteron <rubisetcie@gmail.com>
+ * date:   2024-08-24
+ *
+ * Provides the processing of the files on several threads.
+ *
+ * Every file is processed in temporary files by a worker, then the calling
+ * thread copies them in order to the outputs. The first worker runs on the
+ * job of binclude itself, every other one needs a token from the jobserver
+ * of make (when there's one), which is taken back once there's no more work.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <shlwapi.h>
+#else
+#include <libgen.h>
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#include "parallel.h"
+#include "jobserver.h"
+#include "packer.h"
+#include "config.h"
+
+/* Configuration */
+extern Config config;
+
+#ifndef _WIN32
+
+/* Number of files that can be processed ahead of the copy, per worker */
+#define AHEAD_PER_WORKER 4
+
+typedef struct Slot
+{
+    char *filename;    /* Input file name */
+    char *name;        /* Input base name */
+    FILE *output;      /* Temporary output */
+    FILE *header;      /* Temporary header */
+    int retval;        /* Result of the processing */
+    bool done;         /* Processing finished */
+} Slot;
+
+typedef struct Work
+{
+    Slot *slots;             /* Files to process */
+    int count;               /* Number of files */
+    int next;                /* Next file to process */
+    int copied;              /* Number of files copied to the outputs */
+    int ahead;               /* Number of files that can be processed ahead of the copy */
+    bool hasOutput;          /* Write a source */
+    bool hasHeader;          /* Write a header */
+    bool outputCXX;          /* The source is C++ */
+    bool headerCXX;          /* The header is C++ */
+    pthread_mutex_t mutex;   /* Protection of the progress */
+    pthread_cond_t progress; /* Signaled when a file is processed or copied */
+} Work;
+
+typedef struct Worker
+{
+    pthread_t thread; /* Thread of the worker */
+    Work *work;       /* Shared work */
+    char token;       /* Token taken from the jobserver */
+    bool hasToken;    /* Run on a token of the jobserver */
+} Worker;
+
+/* Process files until there's no more */
+static void *runWorker(void *argument)
+{
+    Worker *worker = argument;
+    Work *work = worker->work;
+    Slot *slot;
+    int index;
+
+    for (;;)
+    {
+        /* Take the next file, without going too far ahead of the copy */
+        pthread_mutex_lock(&work->mutex);
+        while (work->next < work->count && work->next >= work->copied + work->ahead)
+            pthread_cond_wait(&work->progress, &work->mutex);
+
+        index = work->next < work->count ? work->next++ : -1;
+        pthread_mutex_unlock(&work->mutex);
+
+        if (index < 0)
+            break;
+
+        /* Process the file in temporary outputs */
+        slot = &work->slots[index];
+        if ((work->hasOutput && (slot->output = tmpfile()) == NULL) ||
+            (work->hasHeader && (slot->header = tmpfile()) == NULL))
+        {
+            fputs("Failed to create a temporary file!\n", stderr);
+            slot->retval = 3;
+        }
+        else
+            slot->retval = process(slot->filename, slot->name, slot->output, slot->header, work->outputCXX, work->headerCXX);
+
+        pthread_mutex_lock(&work->mutex);
+        slot->done = true;
+        pthread_cond_broadcast(&work->progress);
+        pthread_mutex_unlock(&work->mutex);
+    }
+
+    /* Give the token back as soon as the work is over */
+    if (worker->hasToken)
+        jobserverRelease(worker->token);
+
+    return NULL;
+}
+
+/* Start more workers while there's work left and the jobserver allows it */
+static void scaleUp(Work *work, Worker *workers, int *started, const int limit, const JobserverState jobserver)
+{
+    Worker *worker;
+    bool pending;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&work->mutex);
+        pending = work->next < work->count;
+        pthread_mutex_unlock(&work->mutex);
+
+        if (*started >= limit || !pending)
+            return;
+
+        worker = &workers[*started];
+        worker->work = work;
+        worker->hasToken = false;
+
+        /* The first worker doesn't need a token */
+        if (*started > 0 && jobserver == J_CONNECTED)
+        {
+            if (!jobserverAcquire(&worker->token))
+                return;
+            worker->hasToken = true;
+        }
+
+        if (pthread_create(&worker->thread, NULL, runWorker, worker) != 0)
+        {
+            if (worker->hasToken)
+                jobserverRelease(worker->token);
+            return;
+        }
+        (*started)++;
+    }
+}
+
+/* Copy the content of a temporary file */
+static bool copyFile(FILE *source, FILE *destination)
+{
+    char buffer[65536];
+    size_t size;
+
+    rewind(source);
+    while ((size = fread(buffer, 1, sizeof(buffer), source)) > 0)
+    {
+        if (fwrite(buffer, 1, size, destination) != size)
+            return false;
+    }
+    return !ferror(source);
+}
+
+/* Process all the files on several threads, and write them in order */
+int processParallel(char **files, const int count, FILE *output, FILE *header, bool outputCXX, bool headerCXX, const JobserverState jobserver)
+{
+    Work work;
+    Worker *workers = NULL;
+    int i, limit, started = 0, retval = 0, rv2;
+
+    /* Determine the maximum number of workers */
+    limit = config.jobs > 0 ? config.jobs : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (jobserver == J_UNUSABLE || limit < 1)
+        limit = 1;
+    if (limit > count)
+        limit = count;
+
+    work.slots = calloc(count, sizeof(Slot));
+    workers = calloc(limit, sizeof(Worker));
+    if (work.slots == NULL || workers == NULL)
+    {
+        fputs("Failed to allocate memory for the workers!\n", stderr);
+        retval = 6;
+        goto RETURN;
+    }
+
+    /* Prepare the files (the base names are copied, as basename may return a static buffer) */
+    for (i = 0; i < count; i++)
+    {
+        work.slots[i].filename = files[i];
+        if ((work.slots[i].name = strdup(basename(files[i]))) == NULL)
+        {
+            fputs("Failed to allocate memory for the workers!\n", stderr);
+            retval = 6;
+            goto RETURN;
+        }
+    }
+
+    work.count = count;
+    work.next = 0;
+    work.copied = 0;
+    work.ahead = limit * AHEAD_PER_WORKER;
+    work.hasOutput = output != NULL;
+    work.hasHeader = header != NULL;
+    work.outputCXX = outputCXX;
+    work.headerCXX = headerCXX;
+    pthread_mutex_init(&work.mutex, NULL);
+    pthread_cond_init(&work.progress, NULL);
+
+    scaleUp(&work, workers, &started, limit, jobserver);
+    if (started == 0)
+    {
+        fputs("Failed to start the workers!\n", stderr);
+        retval = 6;
+        goto DESTROY;
+    }
+
+    /* Copy the results in order, scaling up whenever a file is done */
+    for (i = 0; i < count; i++)
+    {
+        pthread_mutex_lock(&work.mutex);
+        while (!work.slots[i].done)
+        {
+            pthread_mutex_unlock(&work.mutex);
+            scaleUp(&work, workers, &started, limit, jobserver);
+            pthread_mutex_lock(&work.mutex);
+
+            if (!work.slots[i].done)
+                pthread_cond_wait(&work.progress, &work.mutex);
+        }
+        pthread_mutex_unlock(&work.mutex);
+
+        rv2 = work.slots[i].retval;
+        if ((work.slots[i].output && !copyFile(work.slots[i].output, output)) ||
+            (work.slots[i].header && !copyFile(work.slots[i].header, header)))
+        {
+            fputs("Failed to copy a temporary file!\n", stderr);
+            rv2 = 5;
+        }
+        if (rv2 != 0 && retval == 0)
+            retval = rv2;
+
+        if (work.slots[i].output)
+            fclose(work.slots[i].output);
+        if (work.slots[i].header)
+            fclose(work.slots[i].header);
+
+        /* Let the workers go further */
+        pthread_mutex_lock(&work.mutex);
+        work.copied++;
+        pthread_cond_broadcast(&work.progress);
+        pthread_mutex_unlock(&work.mutex);
+    }
+
+    for (i = 0; i < started; i++)
+        pthread_join(workers[i].thread, NULL);
+
+  DESTROY:
+
+    pthread_mutex_destroy(&work.mutex);
+    pthread_cond_destroy(&work.progress);
+
+  RETURN:
+
+    if (work.slots)
+    {
+        for (i = 0; i < count; i++)
+            free(work.slots[i].name);
+    }
+    free(work.slots);
+    free(workers);
+
+    return retval;
+}
+
+#else
+
+/* Threads are not supported on Windows: process the files in order */
+int processParallel(char **files, const int count, FILE *output, FILE *header, bool outputCXX, bool headerCXX, const JobserverState jobserver)
+{
+    int i, retval = 0, rv2;
+    (void)jobserver;
+    for (i = 0; i < count; i++)
+    {
+        rv2 = process(files[i], PathFindFileName(files[i]), output, header, outputCXX, headerCXX);
+        if (rv2 != 0 && retval == 0)
+            retval = rv2;
+    }
+    return retval;
+}
+
+#endif
@@ -0,0 +1,18 @@
+/*
+ * Author: Matthieu Carteron <rubisetcie@gmail.com>
+ * date:   2024-08-24
+ *
+ * Provides the processing of the files on several threads.
+ */
+
+#ifndef PARALLEL_H_INCLUDED
+#define PARALLEL_H_INCLUDED
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "jobserver.h"
+
+int processParallel(char **files, const int count, FILE *output, FILE *header, bool outputCXX, bool headerCXX, const JobserverState jobserver);
+
+#endif
@@ -0,0 +1,317 @@
+/*
+ * Author: Matthieu Carteron <rubisetcie@gmail.com>
+ * date:   2024-08-24
+ *
+ * Provides the transformations applied to the data before writing it.
+ *
+ * The transformations are applied in a single streaming pass, in order:
+ * new lines normalization (CRLF to LF), minification (depending on the file
+ * type) and null termination.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "transform.h"
+#include "config.h"
+
+/* Configuration */
+extern Config config;
+
+/* Size of the chunks read from the input */
+#define TRANSFORM_BUFFER_SIZE 65536
+
+typedef enum Minifier
+{
+    M_NONE,
+    M_JSON,  /* Whitespace outside of the strings */
+    M_CLIKE  /* Comments and whitespace of C-like languages (shaders) */
+} Minifier;
+
+typedef enum LexState
+{
+    L_CODE,          /* Between tokens */
+    L_SLASH,         /* After a slash (maybe a comment) */
+    L_LINE_COMMENT,  /* In a line comment */
+    L_BLOCK_COMMENT, /* In a block comment */
+    L_BLOCK_STAR,    /* After a star in a block comment */
+    L_STRING,        /* In a string or character literal */
+    L_ESCAPE         /* After a backslash in a literal */
+} LexState;
+
+typedef struct Transformer
+{
+    FILE *output;      /* Transformed data */
+    Minifier minifier; /* Minification to apply */
+    bool carriage;     /* A carriage return is pending */
+    LexState state;    /* State of the minifier */
+    char quote;        /* Quote closing the current literal */
+    bool space;        /* Whitespace is pending */
+    bool newLine;      /* The pending whitespace has a new line */
+    bool directive;    /* In a preprocessor directive */
+    int last;          /* Last character written (EOF if none in the line) */
+} Transformer;
+
+/* Determine the minification from the file extension */
+static Minifier getMinifier(const char *name)
+{
+    static const char *const json[] = { "json", "gltf", NULL };
+    static const char *const clike[] = { "glsl", "vert", "frag", "geom", "comp", "tesc", "tese", "hlsl", "fx", "wgsl", "metal", "cl", NULL };
+    const char *extension;
+    size_t i;
+
+    if (!config.minify || (extension = strrchr(name, '.')) == NULL)
+        return M_NONE;
+
+    extension++;
+    for (i = 0; json[i] != NULL; i++)
+    {
+        if (strcmp(extension, json[i]) == 0)
+            return M_JSON;
+    }
+    for (i = 0; clike[i] != NULL; i++)
+    {
+        if (strcmp(extension, clike[i]) == 0)
+            return M_CLIKE;
+    }
+    return M_NONE;
+}
+
+/* Check if a character belongs to a word (identifier or number) */
+static bool isWord(const int c)
+{
+    return isalnum(c) || c == '_' || c == '.';
+}
+
+/* Check if a character belongs to an operator */
+static bool isOperator(const int c)
+{
+    return c != EOF && strchr("+-*/%<>=!&|^~?:.#", c) != NULL;
+}
+
+/* Write a character of a token, with the whitespace required before it */
+static void emitToken(Transformer *transformer, const int c)
+{
+    if (transformer->space)
+    {
+        /* New lines end the preprocessor directives */
+        if (transformer->newLine && (transformer->directive || c == '#') && transformer->last != EOF)
+        {
+            fputc('\n', transformer->output);
+            transformer->directive = false;
+            transformer->last = EOF;
+        }
+        /* Keep the spaces separating two words or two operators (always in directives) */
+        else if (transformer->last != EOF && (transformer->directive ||
+                 (isWord(transformer->last) && isWord(c)) ||
+                 (isOperator(transformer->last) && isOperator(c))))
+            fputc(' ', transformer->output);
+
+        transformer->space = false;
+        transformer->newLine = false;
+    }
+
+    if (transformer->last == EOF && c == '#')
+        transformer->directive = true;
+
+    fputc(c, transformer->output);
+    transformer->last = c;
+}
+
+/* Handle whitespace in the code */
+static void emitSpace(Transformer *transformer, const int c)
+{
+    /* A line continuation keeps the directive going */
+    if (c == '\n' && transformer->directive && transformer->last == '\\')
+    {
+        fputc('\n', transformer->output);
+        transformer->last = '\n';
+        return;
+    }
+
+    transformer->space = true;
+    if (c == '\n')
+        transformer->newLine = true;
+}
+
+/* Minify a character of C-like code */
+static void minifyCLike(Transformer *transformer, const int c)
+{
+    switch (transformer->state)
+    {
+        case L_SLASH:
+            if (c == '/')
+            {
+                transformer->state = L_LINE_COMMENT;
+                return;
+            }
+            if (c == '*')
+            {
+                transformer->state = L_BLOCK_COMMENT;
+                return;
+            }
+            transformer->state = L_CODE;
+            emitToken(transformer, '/');
+            break;
+        case L_LINE_COMMENT:
+            if (c == '\n')
+            {
+                transformer->state = L_CODE;
+                emitSpace(transformer, c);
+            }
+            return;
+        case L_BLOCK_COMMENT:
+            if (c == '*')
+                transformer->state = L_BLOCK_STAR;
+            return;
+        case L_BLOCK_STAR:
+            if (c == '/')
+            {
+                /* The comment separates the tokens like a space */
+                transformer->state = L_CODE;
+                emitSpace(transformer, ' ');
+            }
+            else if (c != '*')
+                transformer->state = L_BLOCK_COMMENT;
+            return;
+        case L_STRING:
+            fputc(c, transformer->output);
+            if (c == '\\')
+                transformer->state = L_ESCAPE;
+            else if (c == transformer->quote)
+            {
+                transformer->state = L_CODE;
+                transformer->last = c;
+            }
+            return;
+        case L_ESCAPE:
+            fputc(c, transformer->output);
+            transformer->state = L_STRING;
+            return;
+        default:
+            break;
+    }
+
+    if (c == '/')
+        transformer->state = L_SLASH;
+    else if (isspace(c))
+        emitSpace(transformer, c);
+    else
+    {
+        emitToken(transformer, c);
+        if (c == '"' || c == '\'')
+        {
+            transformer->state = L_STRING;
+            transformer->quote = c;
+        }
+    }
+}
+
+/* Minify a character of JSON */
+static void minifyJSON(Transformer *transformer, const int c)
+{
+    switch (transformer->state)
+    {
+        case L_STRING:
+            if (c == '\\')
+                transformer->state = L_ESCAPE;
+            else if (c == '"')
+                transformer->state = L_CODE;
+            break;
+        case L_ESCAPE:
+            transformer->state = L_STRING;
+            break;
+        default:
+            if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+                return;
+            if (c == '"')
+                transformer->state = L_STRING;
+            break;
+    }
+    fputc(c, transformer->output);
+}
+
+/* Minify a character (after the new lines normalization) */
+static void minify(Transformer *transformer, const int c)
+{
+    switch (transformer->minifier)
+    {
+        case M_JSON:  minifyJSON(transformer, c);     break;
+        case M_CLIKE: minifyCLike(transformer, c);    break;
+        default:      fputc(c, transformer->output); break;
+    }
+}
+
+/* Transform a character */
+static void transformByte(Transformer *transformer, const int c)
+{
+    /* Replace CRLF with LF */
+    if (config.normalizeLines)
+    {
+        if (transformer->carriage)
+        {
+            transformer->carriage = false;
+            if (c != '\n')
+                minify(transformer, '\r');
+        }
+        if (c == '\r')
+        {
+            transformer->carriage = true;
+            return;
+        }
+    }
+    minify(transformer, c);
+}
+
+/* Check if a file has to be transformed */
+bool needsTransform(const char *name)
+{
+    return config.normalizeLines || config.nullTerminate || getMinifier(name) != M_NONE;
+}
+
+/* Transform the input in a temporary file (positioned at the start), NULL if failed */
+FILE *transform(FILE *input, const char *name)
+{
+    unsigned char buffer[TRANSFORM_BUFFER_SIZE];
+    Transformer transformer;
+    size_t size, i;
+
+    if ((transformer.output = tmpfile()) == NULL)
+        return NULL;
+
+    transformer.minifier = getMinifier(name);
+    transformer.carriage = false;
+    transformer.state = L_CODE;
+    transformer.quote = '"';
+    transformer.space = false;
+    transformer.newLine = false;
+    transformer.directive = false;
+    transformer.last = EOF;
+
+    while ((size = fread(buffer, 1, sizeof(buffer), input)) > 0)
+    {
+        for (i = 0; i < size; i++)
+            transformByte(&transformer, buffer[i]);
+    }
+
+    /* Flush the pending characters */
+    if (transformer.carriage)
+        minify(&transformer, '\r');
+    if (transformer.minifier == M_CLIKE && transformer.state == L_SLASH)
+        emitToken(&transformer, '/');
+    if (transformer.minifier == M_CLIKE && transformer.directive)
+        fputc('\n', transformer.output);
+
+    if (config.nullTerminate)
+        fputc('\0', transformer.output);
+
+    if (ferror(input) || ferror(transformer.output))
+    {
+        fclose(transformer.output);
+        return NULL;
+    }
+
+    rewind(transformer.output);
+    return transformer.output;
+}
@@ -0,0 +1,17 @@
+/*
+ * Author: Matthieu Carteron <rubisetcie@gmail.com>
+ * date:   2024-08-24
+ *
+ * Provides the transformations applied to the data before writing it.
+ */
+
+#ifndef TRANSFORM_H_INCLUDED
+#define TRANSFORM_H_INCLUDED
+
+#include <stdio.h>
+#include <stdbool.h>
+
+bool needsTransform(const char *name);
+FILE *transform(FILE *input, const char *name);
+
+#endif